@@ -76,6 +76,8 @@ static void group_add                   (EelCanvasGroup *group,
 static void group_remove                (EelCanvasGroup *group,
 					 EelCanvasItem  *item);
 static void redraw_and_repick_if_mapped (EelCanvasItem *item);
+static void group_damage_child          (EelCanvasGroup *group,
+					 EelCanvasItem  *item);
 
 /*** EelCanvasItem ***/
 
@@ -521,9 +523,10 @@ eel_canvas_item_move (EelCanvasItem *item, double dx, double dy)
 
 	if (!(item->flags & EEL_CANVAS_ITEM_NEED_DEEP_UPDATE)) {
 		item->flags |= EEL_CANVAS_ITEM_NEED_DEEP_UPDATE;
-		if (item->parent != NULL)
+		if (item->parent != NULL) {
+			group_damage_child (EEL_CANVAS_GROUP (item->parent), item);
 			eel_canvas_item_request_update (item->parent);
-		else
+		} else
 			eel_canvas_request_update (item->canvas);
 	}
 
@@ -1130,6 +1133,8 @@ eel_canvas_item_request_update (EelCanvasItem *item)
 	item->flags |= EEL_CANVAS_ITEM_NEED_UPDATE;
 
 	if (item->parent != NULL) {
+		group_damage_child (EEL_CANVAS_GROUP (item->parent), item);
+
 		/* Recurse up the tree */
 		eel_canvas_item_request_update (item->parent);
 	} else {
@@ -1324,9 +1329,10 @@ eel_canvas_group_set_property (GObject *gobject, guint param_id,
 
 	if (moved) {
 		item->flags |= EEL_CANVAS_ITEM_NEED_DEEP_UPDATE;
-		if (item->parent != NULL)
+		if (item->parent != NULL) {
+			group_damage_child (EEL_CANVAS_GROUP (item->parent), item);
 			eel_canvas_item_request_update (item->parent);
-		else
+		} else
 			eel_canvas_request_update (item->canvas);
 	}
 }
@@ -1386,7 +1392,7 @@ static void
 eel_canvas_group_update (EelCanvasItem *item, double i2w_dx, double i2w_dy, int flags)
 {
 	EelCanvasGroup *group;
-	GList *list;
+	GList *list, *damaged;
 	EelCanvasItem *i;
 	double bbox_x0, bbox_y0, bbox_x1, bbox_y1;
 	gboolean first = TRUE;
@@ -1395,6 +1401,33 @@ eel_canvas_group_update (EelCanvasItem *item, double i2w_dx, double i2w_dy, int
 
 	(* group_parent_class->update) (item, i2w_dx, i2w_dy, flags);
 
+	damaged = group->damaged_items;
+	group->damaged_items = NULL;
+	for (list = damaged; list; list = list->next) {
+		i = list->data;
+		i->flags &= ~EEL_CANVAS_ITEM_DAMAGED;
+	}
+
+	if (!(flags & EEL_CANVAS_UPDATE_DEEP)) {
+		/* Only the children that asked for it need an update, the
+		 * others would ignore it. The bounds can only grow here, a
+		 * deep update makes them exact again.
+		 */
+		for (list = damaged; list; list = list->next) {
+			i = list->data;
+
+			eel_canvas_item_invoke_update (i, i2w_dx + group->xpos, i2w_dy + group->ypos, flags);
+
+			item->x1 = MIN (item->x1, i->x1);
+			item->y1 = MIN (item->y1, i->y1);
+			item->x2 = MAX (item->x2, i->x2);
+			item->y2 = MAX (item->y2, i->y2);
+		}
+		g_list_free (damaged);
+		return;
+	}
+	g_list_free (damaged);
+
 	bbox_x0 = 0;
 	bbox_y0 = 0;
 	bbox_x1 = 0;
@@ -1665,6 +1698,19 @@ eel_canvas_group_bounds (EelCanvasItem *item, double *x1, double *y1, double *x2
 	*y2 = maxy;
 }
 
+/* Remembers that @item needs an update, so that updating the group
+ * does not have to visit all children.
+ */
+static void
+group_damage_child (EelCanvasGroup *group, EelCanvasItem *item)
+{
+	if (item->flags & EEL_CANVAS_ITEM_DAMAGED)
+		return;
+
+	item->flags |= EEL_CANVAS_ITEM_DAMAGED;
+	group->damaged_items = g_list_prepend (group->damaged_items, item);
+}
+
 /* Adds an item to a group */
 static void
 group_add (EelCanvasGroup *group, EelCanvasItem *item)
@@ -1677,6 +1723,9 @@ group_add (EelCanvasGroup *group, EelCanvasItem *item)
 	} else
 		group->item_list_end = g_list_append (group->item_list_end, item)->next;
 
+	if (item->flags & (EEL_CANVAS_ITEM_NEED_UPDATE | EEL_CANVAS_ITEM_NEED_DEEP_UPDATE))
+		group_damage_child (group, item);
+
 	if (item->flags & EEL_CANVAS_ITEM_VISIBLE &&
 	    group->item.flags & EEL_CANVAS_ITEM_MAPPED) {
 		if (!(item->flags & EEL_CANVAS_ITEM_REALIZED))
@@ -1711,6 +1760,11 @@ group_remove (EelCanvasGroup *group, EelCanvasItem *item)
 			if (item->flags & EEL_CANVAS_ITEM_VISIBLE)
 				eel_canvas_queue_resize (item->canvas);
 
+			if (item->flags & EEL_CANVAS_ITEM_DAMAGED) {
+				item->flags &= ~EEL_CANVAS_ITEM_DAMAGED;
+				group->damaged_items = g_list_remove (group->damaged_items, item);
+			}
+
 			/* Unparent the child */
 
 			item->parent = NULL;
@@ -91,7 +91,8 @@ enum {
 	EEL_CANVAS_ITEM_ALWAYS_REDRAW    = 1 << 6,
 	EEL_CANVAS_ITEM_VISIBLE          = 1 << 7,
 	EEL_CANVAS_ITEM_NEED_UPDATE      = 1 << 8,
-	EEL_CANVAS_ITEM_NEED_DEEP_UPDATE = 1 << 9
+	EEL_CANVAS_ITEM_NEED_DEEP_UPDATE = 1 << 9,
+	EEL_CANVAS_ITEM_DAMAGED          = 1 << 10
 };
 
 /* Update flags for items */
@@ -327,6 +328,9 @@ struct _EelCanvasGroup {
 	/* Children of the group */
 	GList *item_list;
 	GList *item_list_end;
+
+	/* Children that need an update, see group_damage_child() */
+	GList *damaged_items;
 };
 
 struct _EelCanvasGroupClass {
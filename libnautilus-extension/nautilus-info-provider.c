@@ -88,6 +88,38 @@ nautilus_info_provider_update_file_info (NautilusInfoProvider *provider,
 		(provider, file, update_complete, handle);
 }
 
+/**
+ * nautilus_info_provider_update_file_info_batch:
+ * @provider: a #NautilusInfoProvider
+ * @files: (element-type NautilusFileInfo): the files to update
+ * @update_complete: the closure to invoke once all of @files are done
+ * @handle: (out): handle for nautilus_info_provider_cancel_update()
+ *
+ * Same as nautilus_info_provider_update_file_info(), for a list of files
+ * at once. Providers that can answer for many files with a single query,
+ * like version control or sync status providers, should implement it
+ * instead of being called once per file.
+ *
+ * Returns: a #NautilusOperationResult for the whole list
+ */
+NautilusOperationResult
+nautilus_info_provider_update_file_info_batch (NautilusInfoProvider *provider,
+					       GList *files,
+					       GClosure *update_complete,
+					       NautilusOperationHandle **handle)
+{
+	g_return_val_if_fail (NAUTILUS_IS_INFO_PROVIDER (provider),
+			      NAUTILUS_OPERATION_FAILED);
+	g_return_val_if_fail (NAUTILUS_INFO_PROVIDER_GET_IFACE (provider)->update_file_info_batch != NULL,
+			      NAUTILUS_OPERATION_FAILED);
+	g_return_val_if_fail (update_complete != NULL,
+			      NAUTILUS_OPERATION_FAILED);
+	g_return_val_if_fail (handle != NULL, NAUTILUS_OPERATION_FAILED);
+
+	return NAUTILUS_INFO_PROVIDER_GET_IFACE (provider)->update_file_info_batch
+		(provider, files, update_complete, handle);
+}
+
 void
 nautilus_info_provider_cancel_update (NautilusInfoProvider *provider,
 				      NautilusOperationHandle *handle)
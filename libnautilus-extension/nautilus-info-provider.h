@@ -54,6 +54,10 @@ typedef void (*NautilusInfoProviderUpdateComplete) (NautilusInfoProvider    *pro
  *   See nautilus_info_provider_update_file_info() for details.
  * @cancel_update: Cancels a previous call to nautilus_info_provider_update_file_info().
  *   See nautilus_info_provider_cancel_update() for details.
+ * @update_file_info_batch: Returns a #NautilusOperationResult.
+ *   See nautilus_info_provider_update_file_info_batch() for details.
+ *   Optional, providers that only implement @update_file_info are
+ *   called once per file.
  *
  * Interface for extensions to provide additional information about files.
  */
@@ -66,6 +70,10 @@ struct _NautilusInfoProviderIface {
 						     NautilusOperationHandle **handle);
 	void                    (*cancel_update)    (NautilusInfoProvider     *provider,
 						     NautilusOperationHandle  *handle);
+	NautilusOperationResult (*update_file_info_batch) (NautilusInfoProvider     *provider,
+							   GList                    *files,
+							   GClosure                 *update_complete,
+							   NautilusOperationHandle **handle);
 };
 
 /* Interface Functions */
@@ -76,6 +84,10 @@ NautilusOperationResult nautilus_info_provider_update_file_info       (NautilusI
 								       NautilusOperationHandle **handle);
 void                    nautilus_info_provider_cancel_update          (NautilusInfoProvider     *provider,
 								       NautilusOperationHandle  *handle);
+NautilusOperationResult nautilus_info_provider_update_file_info_batch (NautilusInfoProvider     *provider,
+								       GList                    *files,
+								       GClosure                 *update_complete,
+								       NautilusOperationHandle **handle);
 
 
 
@@ -44,6 +44,7 @@
 #include "nautilus-file-operations.h"
 #include "nautilus-global-preferences.h"
 #include "nautilus-lib-self-check-functions.h"
+#include "nautilus-metadata-store.h"
 #include "nautilus-module.h"
 #include "nautilus-profile.h"
 #include "nautilus-signaller.h"
@@ -1191,6 +1192,7 @@ nautilus_application_quit_mainloop (GApplication *app)
 	DEBUG ("Quitting mainloop");
 
 	nautilus_icon_info_clear_caches ();
+	nautilus_metadata_store_flush ();
 
 	G_APPLICATION_CLASS (nautilus_application_parent_class)->quit_mainloop (app);
 }
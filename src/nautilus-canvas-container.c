@@ -121,6 +121,13 @@
 /* Copied from NautilusCanvasContainer */
 #define NAUTILUS_CANVAS_CONTAINER_SEARCH_DIALOG_TIMEOUT 5
 
+/* Number of icons from which on only the icons near the visible area
+ * get canvas items, and how many unused canvas items are kept around
+ * for reuse.
+ */
+#define VIRTUALIZE_ICON_COUNT 2000
+#define ITEM_POOL_SIZE 64
+
 /* Copied from NautilusFile */
 #define UNDEFINED_TIME ((time_t) (-1))
 
@@ -165,6 +172,11 @@ static GList *       nautilus_canvas_container_get_selected_icons (NautilusCanva
 static void          nautilus_canvas_container_update_visible_icons   (NautilusCanvasContainer *container);
 static void          reveal_icon                                    (NautilusCanvasContainer *container,
 								       NautilusCanvasIcon *icon);
+static void          icon_ensure_item                               (NautilusCanvasContainer *container,
+								     NautilusCanvasIcon          *icon);
+static void          destroy_item_pool                              (NautilusCanvasContainer *container);
+static void          icon_update_item                               (NautilusCanvasContainer *container,
+								     NautilusCanvasIcon          *icon);
 
 static void	     nautilus_canvas_container_set_rtl_positions (NautilusCanvasContainer *container);
 static double	     get_mirror_x_position                     (NautilusCanvasContainer *container,
@@ -238,6 +250,10 @@ enum {
 typedef struct {
 	int **icon_grid;
 	int *grid_memory;
+	/* For each column, the first row that is not taken; all rows
+	 * above it are. Lets find_empty_location() skip full stretches.
+	 */
+	int *first_free_row;
 	int num_rows;
 	int num_columns;
 	gboolean tight;
@@ -251,16 +267,158 @@ static void
 icon_free (NautilusCanvasIcon *icon)
 {
 	/* Destroy this icon item; the parent will unref it. */
-	eel_canvas_item_destroy (EEL_CANVAS_ITEM (icon->item));
+	if (icon->item != NULL) {
+		eel_canvas_item_destroy (EEL_CANVAS_ITEM (icon->item));
+	}
+	g_free (icon->uri);
 	g_free (icon);
 }
 
+static void
+icon_index_uri (NautilusCanvasContainer *container,
+		NautilusCanvasIcon *icon)
+{
+	icon->uri = nautilus_canvas_container_get_icon_uri (container, icon);
+	if (icon->uri != NULL) {
+		g_hash_table_insert (container->details->icons_by_uri, icon->uri, icon);
+	}
+}
+
+static void
+icon_unindex_uri (NautilusCanvasContainer *container,
+		  NautilusCanvasIcon *icon)
+{
+	GHashTable *icons_by_uri;
+
+	icons_by_uri = container->details->icons_by_uri;
+
+	if (icon->uri != NULL &&
+	    g_hash_table_lookup (icons_by_uri, icon->uri) == icon) {
+		g_hash_table_remove (icons_by_uri, icon->uri);
+	}
+	g_free (icon->uri);
+	icon->uri = NULL;
+}
+
 static gboolean
 icon_is_positioned (const NautilusCanvasIcon *icon)
 {
 	return icon->x != ICON_UNPOSITIONED_VALUE && icon->y != ICON_UNPOSITIONED_VALUE;
 }
 
+/* Where the canvas item of the icon is placed, in world coordinates. */
+static void
+icon_get_origin (const NautilusCanvasIcon *icon,
+		 double *x, double *y)
+{
+	*x = icon->x == ICON_UNPOSITIONED_VALUE ? 0 : icon->x;
+	*y = icon->y == ICON_UNPOSITIONED_VALUE ? 0 : icon->y;
+}
+
+static EelDRect
+drect_offset (EelDRect rect, double dx, double dy)
+{
+	rect.x0 += dx;
+	rect.y0 += dy;
+	rect.x1 += dx;
+	rect.y1 += dy;
+
+	return rect;
+}
+
+/* Remember the geometry of the canvas item, so the icon can be laid
+ * out and hit tested once the item has been released.
+ */
+static void
+icon_save_geometry (NautilusCanvasIcon *icon)
+{
+	EelDRect rect;
+	double x, y;
+
+	icon_get_origin (icon, &x, &y);
+
+	rect = nautilus_canvas_item_get_icon_rectangle (icon->item);
+	icon->icon_rect = drect_offset (rect, -x, -y);
+
+	nautilus_canvas_item_get_bounds_for_layout (icon->item,
+						    &rect.x0, &rect.y0,
+						    &rect.x1, &rect.y1);
+	icon->layout_rect = drect_offset (rect, -x, -y);
+
+	nautilus_canvas_item_get_bounds_for_entire_item (icon->item,
+							 &rect.x0, &rect.y0,
+							 &rect.x1, &rect.y1);
+	icon->entire_rect = drect_offset (rect, -x, -y);
+}
+
+/* Get the rectangle of the image only, in world coordinates. */
+static EelDRect
+icon_get_icon_rectangle (const NautilusCanvasIcon *icon)
+{
+	double x, y;
+
+	if (icon->item != NULL) {
+		return nautilus_canvas_item_get_icon_rectangle (icon->item);
+	}
+
+	icon_get_origin (icon, &x, &y);
+	return drect_offset (icon->icon_rect, x, y);
+}
+
+static void
+icon_get_bounds (const NautilusCanvasIcon *icon,
+		 double *x1, double *y1,
+		 double *x2, double *y2,
+		 NautilusCanvasItemBoundsUsage usage)
+{
+	EelDRect rect;
+	double x, y;
+
+	if (icon->item != NULL) {
+		if (usage == BOUNDS_USAGE_FOR_DISPLAY) {
+			eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
+						    x1, y1, x2, y2);
+		} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
+			nautilus_canvas_item_get_bounds_for_layout (icon->item,
+								    x1, y1, x2, y2);
+		} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
+			nautilus_canvas_item_get_bounds_for_entire_item (icon->item,
+									 x1, y1, x2, y2);
+		} else {
+			g_assert_not_reached ();
+		}
+		return;
+	}
+
+	/* The saved layout bounds are for the ellipsized label; selected
+	 * icons and icons in the last line show the entire text.
+	 */
+	if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM ||
+	    icon->entire_text ||
+	    (usage == BOUNDS_USAGE_FOR_DISPLAY && icon->is_selected)) {
+		rect = icon->entire_rect;
+	} else {
+		rect = icon->layout_rect;
+	}
+
+	icon_get_origin (icon, &x, &y);
+	*x1 = rect.x0 + x;
+	*y1 = rect.y0 + y;
+	*x2 = rect.x1 + x;
+	*y2 = rect.y1 + y;
+}
+
+static void
+icon_set_entire_text (NautilusCanvasIcon *icon,
+		      gboolean entire_text)
+{
+	icon->entire_text = entire_text;
+
+	if (icon->item != NULL) {
+		nautilus_canvas_item_set_entire_text (icon->item, entire_text);
+	}
+}
+
 
 /* x, y are the top-left coordinates of the icon. */
 static void
@@ -281,9 +439,12 @@ icon_set_position (NautilusCanvasIcon *icon,
 		return;
 	}
 
-	container = NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (icon->item)->canvas);
+	/* Fixed size containers are never virtualized, so icons without
+	 * a canvas item need no clipping.
+	 */
+	container = icon->item != NULL ? NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (icon->item)->canvas) : NULL;
 
-	if (nautilus_canvas_container_get_is_fixed_size (container)) {
+	if (container != NULL && nautilus_canvas_container_get_is_fixed_size (container)) {
 		/*  FIXME: This should be:
 
 		    container_x = GTK_WIDGET (container)->allocation.x;
@@ -317,7 +478,7 @@ icon_set_position (NautilusCanvasIcon *icon,
 		item_width = x2 - x1;
 		item_height = y2 - y1;
 
-		icon_bounds = nautilus_canvas_item_get_icon_rectangle (icon->item);
+		icon_bounds = icon_get_icon_rectangle (icon);
 
 		/* determine icon rectangle relative to item rectangle */
 		height_above = icon_bounds.y0 - y1;
@@ -339,9 +500,11 @@ icon_set_position (NautilusCanvasIcon *icon,
 		icon->y = 0;
 	}
 	
-	eel_canvas_item_move (EEL_CANVAS_ITEM (icon->item),
-			      x - icon->x,
-			      y - icon->y);
+	if (icon->item != NULL) {
+		eel_canvas_item_move (EEL_CANVAS_ITEM (icon->item),
+				      x - icon->x,
+				      y - icon->y);
+	}
 
 	icon->x = x;
 	icon->y = y;
@@ -423,6 +586,10 @@ static void
 icon_raise (NautilusCanvasIcon *icon)
 {
 	EelCanvasItem *item, *band;
+
+	if (icon->item == NULL) {
+		return;
+	}
 	
 	item = EEL_CANVAS_ITEM (icon->item);
 	band = NAUTILUS_CANVAS_CONTAINER (item->canvas)->details->rubberband_info.selection_rectangle;
@@ -446,21 +613,31 @@ emit_stretch_ended (NautilusCanvasContainer *container, NautilusCanvasIcon *icon
 		       icon->data);
 }
 
+static void
+invalidate_selection (NautilusCanvasContainer *container)
+{
+	g_list_free (container->details->selection);
+	container->details->selection = NULL;
+	container->details->selection_valid = FALSE;
+}
+
 static void
 icon_toggle_selected (NautilusCanvasContainer *container,
 		      NautilusCanvasIcon *icon)
 {		
 	icon->is_selected = !icon->is_selected;
 	if (icon->is_selected) {
-		container->details->selection = g_list_prepend (container->details->selection, icon->data);
-		container->details->selection_needs_resort = TRUE;
+		container->details->selection_count++;
 	} else {
-		container->details->selection = g_list_remove (container->details->selection, icon->data);
+		container->details->selection_count--;
 	}
+	invalidate_selection (container);
 
-	eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
-			     "highlighted_for_selection", (gboolean) icon->is_selected,
-			     NULL);
+	if (icon->item != NULL) {
+		eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
+				     "highlighted_for_selection", (gboolean) icon->is_selected,
+				     NULL);
+	}
 
 	/* If the icon is deselected, then get rid of the stretch handles.
 	 * No harm in doing the same if the item is newly selected.
@@ -512,18 +689,7 @@ icon_get_bounding_box (NautilusCanvasIcon *icon,
 {
 	double x1, y1, x2, y2;
 
-	if (usage == BOUNDS_USAGE_FOR_DISPLAY) {
-		eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-					    &x1, &y1, &x2, &y2);
-	} else if (usage == BOUNDS_USAGE_FOR_LAYOUT) {
-		nautilus_canvas_item_get_bounds_for_layout (icon->item,
-								   &x1, &y1, &x2, &y2);
-	} else if (usage == BOUNDS_USAGE_FOR_ENTIRE_ITEM) {
-		nautilus_canvas_item_get_bounds_for_entire_item (icon->item,
-									&x1, &y1, &x2, &y2);
-	} else {
-		g_assert_not_reached ();
-	}
+	icon_get_bounds (icon, &x1, &y1, &x2, &y2, usage);
 
 	if (x1_return != NULL) {
 		*x1_return = x1;
@@ -569,67 +735,43 @@ nautilus_canvas_container_scroll (NautilusCanvasContainer *container,
 	return gtk_adjustment_get_value (hadj) != old_h_value || gtk_adjustment_get_value (vadj) != old_v_value;
 }
 
-static void
-pending_icon_to_reveal_destroy_callback (NautilusCanvasItem *item,
-					   NautilusCanvasContainer *container)
-{
-	g_assert (NAUTILUS_IS_CANVAS_CONTAINER (container));
-	g_assert (container->details->pending_icon_to_reveal != NULL);
-	g_assert (container->details->pending_icon_to_reveal->item == item);
-
-	container->details->pending_icon_to_reveal = NULL;
-}
-
 static NautilusCanvasIcon *
 get_pending_icon_to_reveal (NautilusCanvasContainer *container)
 {
 	return container->details->pending_icon_to_reveal;
 }
 
+/* The pending icon is reset by icon_destroy() and
+ * nautilus_canvas_container_clear(), it does not need to have
+ * a canvas item.
+ */
 static void
 set_pending_icon_to_reveal (NautilusCanvasContainer *container, NautilusCanvasIcon *icon)
 {
-	NautilusCanvasIcon *old_icon;
-	
-	old_icon = container->details->pending_icon_to_reveal;
-	
-	if (icon == old_icon) {
-		return;
-	}
-	
-	if (old_icon != NULL) {
-		g_signal_handlers_disconnect_by_func
-			(old_icon->item,
-			 G_CALLBACK (pending_icon_to_reveal_destroy_callback),
-			 container);
-	}
-	
-	if (icon != NULL) {
-		g_signal_connect (icon->item, "destroy",
-				  G_CALLBACK (pending_icon_to_reveal_destroy_callback),
-				  container);
-	}
-	
 	container->details->pending_icon_to_reveal = icon;
 }
 
 static void
-item_get_canvas_bounds (EelCanvasItem *item,
+icon_get_canvas_bounds (NautilusCanvasContainer *container,
+			NautilusCanvasIcon *icon,
 			EelIRect *bounds)
 {
 	EelDRect world_rect;
 	
-	eel_canvas_item_get_bounds (item,
-				    &world_rect.x0,
-				    &world_rect.y0,
-				    &world_rect.x1,
-				    &world_rect.y1);
-	eel_canvas_item_i2w (item->parent,
-			     &world_rect.x0,
-			     &world_rect.y0);
-	eel_canvas_item_i2w (item->parent,
-			     &world_rect.x1,
-			     &world_rect.y1);
+	icon_get_bounds (icon,
+			 &world_rect.x0,
+			 &world_rect.y0,
+			 &world_rect.x1,
+			 &world_rect.y1,
+			 BOUNDS_USAGE_FOR_DISPLAY);
+	if (icon->item != NULL) {
+		eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
+				     &world_rect.x0,
+				     &world_rect.y0);
+		eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
+				     &world_rect.x1,
+				     &world_rect.y1);
+	}
 
 	world_rect.x0 -= ICON_PAD_LEFT + ICON_PAD_RIGHT;
 	world_rect.x1 += ICON_PAD_LEFT + ICON_PAD_RIGHT;
@@ -637,12 +779,12 @@ item_get_canvas_bounds (EelCanvasItem *item,
 	world_rect.y0 -= ICON_PAD_TOP + ICON_PAD_BOTTOM;
 	world_rect.y1 += ICON_PAD_TOP + ICON_PAD_BOTTOM;
 
-	eel_canvas_w2c (item->canvas,
+	eel_canvas_w2c (EEL_CANVAS (container),
 			world_rect.x0,
 			world_rect.y0,
 			&bounds->x0,
 			&bounds->y0);
-	eel_canvas_w2c (item->canvas,
+	eel_canvas_w2c (EEL_CANVAS (container),
 			world_rect.x1,
 			world_rect.y1,
 			&bounds->x1,
@@ -658,7 +800,7 @@ icon_get_row_and_column_bounds (NautilusCanvasContainer *container,
 	NautilusCanvasIcon *one_icon;
 	EelIRect one_bounds;
 
-	item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), bounds);
+	icon_get_canvas_bounds (container, icon, bounds);
 
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		one_icon = p->data;
@@ -668,13 +810,13 @@ icon_get_row_and_column_bounds (NautilusCanvasContainer *container,
 		}
 
 		if (compare_icons_horizontal (container, icon, one_icon) == 0) {
-			item_get_canvas_bounds (EEL_CANVAS_ITEM (one_icon->item), &one_bounds);
+			icon_get_canvas_bounds (container, one_icon, &one_bounds);
 			bounds->x0 = MIN (bounds->x0, one_bounds.x0);
 			bounds->x1 = MAX (bounds->x1, one_bounds.x1);
 		}
 
 		if (compare_icons_vertical (container, icon, one_icon) == 0) {
-			item_get_canvas_bounds (EEL_CANVAS_ITEM (one_icon->item), &one_bounds);
+			icon_get_canvas_bounds (container, one_icon, &one_bounds);
 			bounds->y0 = MIN (bounds->y0, one_bounds.y0);
 			bounds->y1 = MAX (bounds->y1, one_bounds.y1);
 		}
@@ -707,7 +849,7 @@ reveal_icon (NautilusCanvasContainer *container,
 		/* ensure that we reveal the entire row/column */
 		icon_get_row_and_column_bounds (container, icon, &bounds);
 	} else {
-		item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), &bounds);
+		icon_get_canvas_bounds (container, icon, &bounds);
 	}
 	if (bounds.y0 < gtk_adjustment_get_value (vadj)) {
 		gtk_adjustment_set_value (vadj, bounds.y0);
@@ -830,6 +972,11 @@ set_focus (NautilusCanvasContainer *container,
 
 	clear_focus (container);
 
+	/* The focused icon keeps its canvas item while it is scrolled
+	 * away, see icon_is_pinned().
+	 */
+	icon_ensure_item (container, icon);
+
 	container->details->focus = icon;
 	container->details->keyboard_focus = keyboard_focus;
 
@@ -1180,7 +1327,6 @@ sort_selection (NautilusCanvasContainer *container)
 	container->details->selection = g_list_sort_with_data (container->details->selection,
 							       compare_icons_data,
 							       container);
-	container->details->selection_needs_resort = FALSE;
 }
 
 static void
@@ -1241,7 +1387,7 @@ lay_down_one_line (NautilusCanvasContainer *container,
 			(icon,
 			 is_rtl ? get_mirror_x_position (container, icon, x + position->x_offset) : x + position->x_offset,
 			 y + y_offset);
-		nautilus_canvas_item_set_entire_text (icon->item, whole_text);
+		icon_set_entire_text (icon, whole_text);
 
 		icon->saved_ltr_x = is_rtl ? get_mirror_x_position (container, icon, icon->x) : icon->x;
 
@@ -1249,24 +1395,64 @@ lay_down_one_line (NautilusCanvasContainer *container,
 	}
 }
 
+/* Measure the icon for the grid layout, unless it has not changed since
+ * the last time.
+ */
 static void
-lay_down_icons_horizontal (NautilusCanvasContainer *container,
-			     GList *icons,
-			     double start_y)
+icon_ensure_layout_size (NautilusCanvasIcon *icon)
+{
+	EelDRect bounds;
+	EelDRect icon_bounds;
+
+	if (icon->has_layout_size) {
+		return;
+	}
+
+	/* Measure the ellipsized label; lay_down_one_line() shows the
+	 * entire text in the last line again.
+	 */
+	icon_set_entire_text (icon, FALSE);
+
+	/* Assume it's only one level hierarchy to avoid costly affine calculations */
+	icon_get_bounds (icon,
+			 &bounds.x0, &bounds.y0,
+			 &bounds.x1, &bounds.y1,
+			 BOUNDS_USAGE_FOR_LAYOUT);
+	icon_bounds = icon_get_icon_rectangle (icon);
+
+	icon->layout_width = bounds.x1 - bounds.x0;
+
+	/* Calculate size above/below baseline */
+	icon->layout_height_above = icon_bounds.y1 - bounds.y0;
+	icon->layout_height_below = bounds.y1 - icon_bounds.y1;
+
+	icon->image_width = icon_bounds.x1 - icon_bounds.x0;
+	icon->image_height = icon_bounds.y1 - icon_bounds.y0;
+
+	icon->has_layout_size = TRUE;
+}
+
+/* Lay out @icons a line at a time, the first line starting at @y.
+ * Once past @last_changed, stop as soon as a line starts where it
+ * did in the previous layout, since the rest is the same then.
+ */
+static void
+lay_down_lines_horizontal (NautilusCanvasContainer *container,
+			   GList *icons,
+			   double y,
+			   GList *last_changed)
 {
 	GList *p, *line_start;
-	NautilusCanvasIcon *icon;
-	double canvas_width, y;
+	NautilusCanvasIcon *icon, *prev;
+	double canvas_width;
 	GArray *positions;
 	IconPositions *position;
-	EelDRect bounds;
-	EelDRect icon_bounds;
 	double max_height_above, max_height_below;
-	double height_above, height_below;
 	double line_width;
 	double grid_width;
 	int icon_width, icon_size;
 	int i;
+	gboolean past_changes;
 	GtkAllocation allocation;
 
 	g_assert (NAUTILUS_IS_CANVAS_CONTAINER (container));
@@ -1286,30 +1472,23 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
 
 	line_width = 0;
 	line_start = icons;
-	y = start_y + CONTAINER_PAD_TOP;
 	i = 0;
+	past_changes = FALSE;
 	
 	max_height_above = 0;
 	max_height_below = 0;
 	for (p = icons; p != NULL; p = p->next) {
 		icon = p->data;
+		prev = p->prev != NULL ? p->prev->data : NULL;
 
-		/* Assume it's only one level hierarchy to avoid costly affine calculations */
-		nautilus_canvas_item_get_bounds_for_layout (icon->item,
-							    &bounds.x0, &bounds.y0,
-							    &bounds.x1, &bounds.y1);
+		icon_ensure_layout_size (icon);
 
 		/* Normalize the icon width to the grid unit.
 		 * Use the icon size for this zoom level too in the calculation, since
 		 * the actual bounds might be smaller - e.g. because we have a very
 		 * narrow thumbnail.
 		 */
-		icon_width = ceil (MAX ((bounds.x1 - bounds.x0), icon_size) / grid_width) * grid_width;
-
-		/* Calculate size above/below baseline */
-		icon_bounds = nautilus_canvas_item_get_icon_rectangle (icon->item);
-		height_above = icon_bounds.y1 - bounds.y0;
-		height_below = bounds.y1 - icon_bounds.y1;
+		icon_width = ceil (MAX (icon->layout_width, icon_size) / grid_width) * grid_width;
 
 		/* If this icon doesn't fit, it's time to lay out the line that's queued up. */
 		if (line_start != p && line_width + icon_width >= canvas_width ) {
@@ -1321,28 +1500,46 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
 			/* Advance to next line. */
 			y += max_height_below + ICON_PAD_BOTTOM;
 
+			if (past_changes
+			    && icon->starts_line
+			    && icon->layout_line_y == y
+			    && icon->layout_prev == prev) {
+				line_start = NULL;
+				break;
+			}
+
 			line_width = 0;
 			line_start = p;
 			i = 0;
 			
-			max_height_above = height_above;
-			max_height_below = height_below;
+			max_height_above = icon->layout_height_above;
+			max_height_below = icon->layout_height_below;
 		} else {
-			if (height_above > max_height_above) {
-				max_height_above = height_above;
+			if (icon->layout_height_above > max_height_above) {
+				max_height_above = icon->layout_height_above;
 			}
-			if (height_below > max_height_below) {
-				max_height_below = height_below;
+			if (icon->layout_height_below > max_height_below) {
+				max_height_below = icon->layout_height_below;
 			}
 		}
+
+		icon->starts_line = (p == line_start);
+		if (icon->starts_line) {
+			icon->layout_line_y = y;
+		}
+		icon->layout_prev = prev;
+
+		if (p == last_changed) {
+			past_changes = TRUE;
+		}
 		
 		g_array_set_size (positions, i + 1);
 		position = &g_array_index (positions, IconPositions, i++);
 		position->width = icon_width;
-		position->height = icon_bounds.y1 - icon_bounds.y0;
+		position->height = icon->image_height;
 
-		position->x_offset = (icon_width - (icon_bounds.x1 - icon_bounds.x0)) / 2;
-		position->y_offset = icon_bounds.y0 - icon_bounds.y1;
+		position->x_offset = (icon_width - icon->image_width) / 2;
+		position->y_offset = -icon->image_height;
 
 		/* Add this icon. */
 		line_width += icon_width;
@@ -1359,6 +1556,86 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
 	g_array_free (positions, TRUE);
 }
 
+static void
+lay_down_icons_horizontal (NautilusCanvasContainer *container,
+			     GList *icons,
+			     double start_y)
+{
+	lay_down_lines_horizontal (container, icons, start_y + CONTAINER_PAD_TOP, NULL);
+
+	/* These may not be all icons, in their order; the next layout of
+	 * the whole container has to start from scratch.
+	 */
+	container->details->layout_valid = FALSE;
+}
+
+/* Lay out all icons of a grid layout again, starting with the line
+ * before the first icon that was added, removed, moved or updated since
+ * the last layout. Resizing re-flows all lines, but the icons are not
+ * measured again.
+ */
+static void
+relayout_icons_horizontal (NautilusCanvasContainer *container)
+{
+	NautilusCanvasContainerDetails *details;
+	GList *p, *first_changed, *last_changed, *start;
+	NautilusCanvasIcon *icon, *prev;
+	GtkAllocation allocation;
+	double canvas_width;
+	double y;
+
+	details = container->details;
+
+	gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
+	canvas_width = CANVAS_WIDTH (container, allocation);
+
+	if (!details->layout_valid || details->layout_width != canvas_width) {
+		lay_down_lines_horizontal (container, details->icons, CONTAINER_PAD_TOP, NULL);
+		prev = details->icons != NULL ? g_list_last (details->icons)->data : NULL;
+	} else {
+		first_changed = NULL;
+		last_changed = NULL;
+		prev = NULL;
+		for (p = details->icons; p != NULL; p = p->next) {
+			icon = p->data;
+
+			/* The new last icon has to get its line laid down
+			 * with the entire text.
+			 */
+			if (!icon->has_layout_size
+			    || !icon_is_positioned (icon)
+			    || icon->layout_prev != prev
+			    || (p->next == NULL && icon != details->layout_last_icon)) {
+				if (first_changed == NULL) {
+					first_changed = p;
+				}
+				last_changed = p;
+			}
+			prev = icon;
+		}
+
+		if (first_changed != NULL) {
+			/* The changed icon may fit into the line of the icon before it. */
+			start = first_changed->prev;
+			if (start == NULL) {
+				start = details->icons;
+				y = CONTAINER_PAD_TOP;
+			} else {
+				while (!((NautilusCanvasIcon *) start->data)->starts_line) {
+					start = start->prev;
+				}
+				y = ((NautilusCanvasIcon *) start->data)->layout_line_y;
+			}
+
+			lay_down_lines_horizontal (container, start, y, last_changed);
+		}
+	}
+
+	details->layout_valid = TRUE;
+	details->layout_width = canvas_width;
+	details->layout_last_icon = prev;
+}
+
 static void
 snap_position (NautilusCanvasContainer *container,
 	       NautilusCanvasIcon *icon,
@@ -1373,7 +1650,7 @@ snap_position (NautilusCanvasContainer *container,
 	EelDRect canvas_position;
 	GtkAllocation allocation;
 	
-	canvas_position = nautilus_canvas_item_get_icon_rectangle (icon->item);
+	canvas_position = icon_get_icon_rectangle (icon);
 	icon_width = canvas_position.x1 - canvas_position.x0;
 	icon_height = canvas_position.y1 - canvas_position.y0;
 
@@ -1465,6 +1742,7 @@ placement_grid_new (NautilusCanvasContainer *container, gboolean tight)
 
 	grid->grid_memory = g_new0 (int, (num_rows * num_columns));
 	grid->icon_grid = g_new0 (int *, num_columns);
+	grid->first_free_row = g_new0 (int, num_columns);
 	
 	for (i = 0; i < num_columns; i++) {
 		grid->icon_grid[i] = grid->grid_memory + (i * num_rows);
@@ -1478,6 +1756,7 @@ placement_grid_free (PlacementGrid *grid)
 {
 	g_free (grid->icon_grid);
 	g_free (grid->grid_memory);
+	g_free (grid->first_free_row);
 	g_free (grid);
 }
 
@@ -1516,7 +1795,26 @@ placement_grid_mark (PlacementGrid *grid, EelIRect pos)
 		for (y = pos.y0; y <= pos.y1; y++) {
 			grid->icon_grid[x][y] = 1;
 		}
+
+		while (grid->first_free_row[x] < grid->num_rows &&
+		       grid->icon_grid[x][grid->first_free_row[x]] != 0) {
+			grid->first_free_row[x]++;
+		}
+	}
+}
+
+/* Number of rows @pos has to move down to possibly be free */
+static int
+placement_grid_rows_taken_above (PlacementGrid *grid, EelIRect pos)
+{
+	int x, rows;
+
+	rows = 0;
+	for (x = pos.x0; x <= pos.x1; x++) {
+		rows = MAX (rows, grid->first_free_row[x] - pos.y0);
 	}
+
+	return rows;
 }
 
 static void
@@ -1598,7 +1896,7 @@ find_empty_location (NautilusCanvasContainer *container,
 				 BOUNDS_USAGE_FOR_ENTIRE_ITEM);
 	height_for_bound_check = icon_position.y1 - icon_position.y0;
 
-	pixbuf_rect = nautilus_canvas_item_get_icon_rectangle (icon->item);
+	pixbuf_rect = icon_get_icon_rectangle (icon);
 	
 	/* Start the icon on a grid location */
 	snap_position (container, icon, &start_x, &start_y);
@@ -1611,6 +1909,7 @@ find_empty_location (NautilusCanvasContainer *container,
 	do {
 		EelIRect grid_position;
 		gboolean need_new_column;
+		int rows;
 
 		collision = FALSE;
 		
@@ -1620,6 +1919,17 @@ find_empty_location (NautilusCanvasContainer *container,
 
 		need_new_column = icon_position.y0 + height_for_bound_check + DESKTOP_PAD_VERTICAL > canvas_height;
 
+		if (!need_new_column) {
+			/* Skip the rows known to be taken in one go. */
+			rows = placement_grid_rows_taken_above (grid, grid_position);
+			if (rows > 0) {
+				icon_position.y0 += rows * SNAP_SIZE_Y;
+				icon_position.y1 = icon_position.y0 + icon_height;
+				collision = TRUE;
+				continue;
+			}
+		}
+
 		if (need_new_column ||
 		    !placement_grid_position_is_free (grid, grid_position)) {
 			icon_position.y0 += SNAP_SIZE_Y;
@@ -1698,7 +2008,7 @@ get_mirror_x_position (NautilusCanvasContainer *container, NautilusCanvasIcon *i
 	GtkAllocation allocation;
 
 	gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
-	icon_bounds = nautilus_canvas_item_get_icon_rectangle (icon->item);
+	icon_bounds = icon_get_icon_rectangle (icon);
 
 	return CANVAS_WIDTH(container, allocation) - x - (icon_bounds.x1 - icon_bounds.x0);
 }
@@ -1772,7 +2082,7 @@ lay_down_icons_vertical_desktop (NautilusCanvasContainer *container, GList *icon
 			for (p = unplaced_icons; p != NULL; p = p->next) {
 				icon = p->data;
 				
-				icon_rect = nautilus_canvas_item_get_icon_rectangle (icon->item);
+				icon_rect = icon_get_icon_rectangle (icon);
 				
 				/* Start the icon in the first column */
 				x = DESKTOP_PAD_HORIZONTAL + (SNAP_SIZE_X / 2) - ((icon_rect.x1 - icon_rect.x0) / 2);
@@ -1825,7 +2135,7 @@ lay_down_icons_vertical_desktop (NautilusCanvasContainer *container, GList *icon
 
 				if (should_snap) {
 					/* Snap the baseline to a grid position */
-					icon_rect = nautilus_canvas_item_get_icon_rectangle (icon->item);
+					icon_rect = icon_get_icon_rectangle (icon);
 					baseline = y + (icon_rect.y1 - icon_rect.y0);
 					baseline = SNAP_CEIL_VERTICAL (baseline);
 					y = baseline - (icon_rect.y1 - icon_rect.y0);
@@ -1864,7 +2174,7 @@ lay_down_icons_vertical_desktop (NautilusCanvasContainer *container, GList *icon
 							 BOUNDS_USAGE_FOR_ENTIRE_ITEM);
 				icon_height_for_bound_check = y2 - y1;
 				
-				icon_rect = nautilus_canvas_item_get_icon_rectangle (icon->item);
+				icon_rect = icon_get_icon_rectangle (icon);
 
 				if (should_snap) {
 					baseline = y + (icon_rect.y1 - icon_rect.y0);
@@ -1934,7 +2244,11 @@ redo_layout_internal (NautilusCanvasContainer *container)
 			resort (container);
 			container->details->needs_resort = FALSE;
 		}
-		lay_down_icons (container, container->details->icons, 0);
+		if (container->details->is_desktop) {
+			lay_down_icons (container, container->details->icons, 0);
+		} else {
+			relayout_icons_horizontal (container);
+		}
 	}
 
 	if (nautilus_canvas_container_is_layout_rtl (container)) {
@@ -1994,7 +2308,6 @@ reload_icon_positions (NautilusCanvasContainer *container)
 	NautilusCanvasPosition position;
 	EelDRect bounds;
 	double bottom;
-	EelCanvasItem *item;
 
 	g_assert (!container->details->auto_layout);
 
@@ -2015,18 +2328,12 @@ reload_icon_positions (NautilusCanvasContainer *container)
 			       &have_stored_position);
 		if (have_stored_position) {
 			icon_set_position (icon, position.x, position.y);
-			item = EEL_CANVAS_ITEM (icon->item);
-			nautilus_canvas_item_get_bounds_for_layout (icon->item,
-									   &bounds.x0,
-									   &bounds.y0,
-									   &bounds.x1,
-									   &bounds.y1);
-			eel_canvas_item_i2w (item->parent,
-					     &bounds.x0,
-					     &bounds.y0);
-			eel_canvas_item_i2w (item->parent,
-					     &bounds.x1,
-					     &bounds.y1);
+			icon_get_bounds (icon,
+					 &bounds.x0,
+					 &bounds.y0,
+					 &bounds.x1,
+					 &bounds.y1,
+					 BOUNDS_USAGE_FOR_LAYOUT);
 			if (bounds.y1 > bottom) {
 				bottom = bounds.y1;
 			}
@@ -2059,7 +2366,13 @@ invalidate_label_sizes (NautilusCanvasContainer *container)
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		icon = p->data;
 
-		nautilus_canvas_item_invalidate_label_size (icon->item);		
+		if (icon->item != NULL) {
+			nautilus_canvas_item_invalidate_label_size (icon->item);
+			icon->has_layout_size = FALSE;
+		} else {
+			/* Measure the label again with the new font. */
+			nautilus_canvas_container_update_icon (container, icon);
+		}
 	}
 }
 
@@ -2209,6 +2522,7 @@ rubberband_select (NautilusCanvasContainer *container,
 			
 	selection_changed = FALSE;
 	canvas_rect_calculated = FALSE;
+	canvas = EEL_CANVAS (container);
 
 	for (p = container->details->icons; p != NULL; p = p->next) {
 		icon = p->data;
@@ -2217,7 +2531,6 @@ rubberband_select (NautilusCanvasContainer *container,
 			/* Only do this calculation once, since all the canvas items
 			 * we are interating are in the same coordinate space
 			 */
-			canvas = EEL_CANVAS_ITEM (icon->item)->canvas;
 			eel_canvas_w2c (canvas,
 					current_rect->x0,
 					current_rect->y0,
@@ -2231,7 +2544,7 @@ rubberband_select (NautilusCanvasContainer *container,
 			canvas_rect_calculated = TRUE;
 		}
 		
-		is_in = nautilus_canvas_item_hit_test_rectangle (icon->item, canvas_rect);
+		is_in = nautilus_canvas_container_hit_test_icon (container, icon, canvas_rect);
 
 		selection_changed |= icon_set_selected
 			(container, icon,
@@ -2643,14 +2956,14 @@ compare_icons_horizontal (NautilusCanvasContainer *container,
 	EelDRect world_rect;
 	int ax, bx;
 
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 &ax,
 		 NULL);
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -2675,14 +2988,14 @@ compare_icons_vertical (NautilusCanvasContainer *container,
 	EelDRect world_rect;
 	int ay, by;
 
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 NULL,
 		 &ay);
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -2707,14 +3020,14 @@ compare_icons_horizontal_first (NautilusCanvasContainer *container,
 	EelDRect world_rect;
 	int ax, ay, bx, by;
 
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 &ax,
 		 &ay);
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -2745,14 +3058,14 @@ compare_icons_vertical_first (NautilusCanvasContainer *container,
 	EelDRect world_rect;
 	int ax, ay, bx, by;
 
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_a->item);
+	world_rect = icon_get_icon_rectangle (icon_a);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
 		 get_cmp_point_y (container, world_rect),
 		 &ax,
 		 &ay);
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon_b->item);
+	world_rect = icon_get_icon_rectangle (icon_b);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -2815,18 +3128,44 @@ rightmost_in_bottom_row (NautilusCanvasContainer *container,
 	return compare_icons_vertical_first (container, best_so_far, candidate) < 0;
 }
 
+/* Get the bounds of the icon in canvas pixels, like the x1, y1, x2, y2
+ * of its canvas item.
+ */
+static EelDRect
+icon_get_canvas_extents (NautilusCanvasContainer *container,
+			 NautilusCanvasIcon *icon)
+{
+	EelCanvasItem *item;
+	EelDRect rect;
+
+	if (icon->item != NULL) {
+		item = EEL_CANVAS_ITEM (icon->item);
+		rect.x0 = item->x1;
+		rect.y0 = item->y1;
+		rect.x1 = item->x2;
+		rect.y1 = item->y2;
+		return rect;
+	}
+
+	icon_get_bounds (icon, &rect.x0, &rect.y0, &rect.x1, &rect.y1,
+			 BOUNDS_USAGE_FOR_DISPLAY);
+	eel_canvas_w2c_rect_d (EEL_CANVAS (container),
+			       &rect.x0, &rect.y0, &rect.x1, &rect.y1);
+	return rect;
+}
+
 static int
 compare_with_start_row (NautilusCanvasContainer *container,
 			NautilusCanvasIcon *icon)
 {
-	EelCanvasItem *item;
+	EelDRect extents;
 
-	item = EEL_CANVAS_ITEM (icon->item);
+	extents = icon_get_canvas_extents (container, icon);
 	
-	if (container->details->arrow_key_start_y < item->y1) {
+	if (container->details->arrow_key_start_y < extents.y0) {
 		return -1;
 	}
-	if (container->details->arrow_key_start_y > item->y2) {
+	if (container->details->arrow_key_start_y > extents.y1) {
 		return +1;
 	}
 	return 0;
@@ -2836,14 +3175,14 @@ static int
 compare_with_start_column (NautilusCanvasContainer *container,
 			   NautilusCanvasIcon *icon)
 {
-	EelCanvasItem *item;
+	EelDRect extents;
 
-	item = EEL_CANVAS_ITEM (icon->item);
+	extents = icon_get_canvas_extents (container, icon);
 	
-	if (container->details->arrow_key_start_x < item->x1) {
+	if (container->details->arrow_key_start_x < extents.x0) {
 		return -1;
 	}
-	if (container->details->arrow_key_start_x > item->x2) {
+	if (container->details->arrow_key_start_x > extents.x1) {
 		return +1;
 	}
 	return 0;
@@ -3211,7 +3550,7 @@ closest_in_90_degrees (NautilusCanvasContainer *container,
 	int *best_dist;
 
 
-	world_rect = nautilus_canvas_item_get_icon_rectangle (candidate->item);
+	world_rect = icon_get_icon_rectangle (candidate);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -3275,12 +3614,14 @@ get_rubberband (NautilusCanvasIcon *icon1,
 	EelDRect rect2;
 	EelDRect ret;
 
-	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon1->item),
-				    &rect1.x0, &rect1.y0, 
-				    &rect1.x1, &rect1.y1);
-	eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon2->item),
-				    &rect2.x0, &rect2.y0, 
-				    &rect2.x1, &rect2.y1);
+	icon_get_bounds (icon1,
+			 &rect1.x0, &rect1.y0, 
+			 &rect1.x1, &rect1.y1,
+			 BOUNDS_USAGE_FOR_DISPLAY);
+	icon_get_bounds (icon2,
+			 &rect2.x0, &rect2.y0, 
+			 &rect2.x1, &rect2.y1,
+			 BOUNDS_USAGE_FOR_DISPLAY);
 
 	eel_drect_union (&ret, &rect1, &rect2);
 
@@ -3396,7 +3737,7 @@ record_arrow_key_start (NautilusCanvasContainer *container,
 {
 	EelDRect world_rect;
 
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon->item);
+	world_rect = icon_get_icon_rectangle (icon);
 	eel_canvas_w2c
 		(EEL_CANVAS (container),
 		 get_cmp_point_x (container, world_rect),
@@ -3755,6 +4096,9 @@ finalize (GObject *object)
 
 	g_hash_table_destroy (details->icon_set);
 	details->icon_set = NULL;
+	g_clear_pointer (&details->icons_by_uri, g_hash_table_destroy);
+	g_hash_table_destroy (details->label_sizes);
+	details->label_sizes = NULL;
 
 	g_free (details->font);
 
@@ -3948,7 +4292,7 @@ nautilus_canvas_container_request_update_all_internal (NautilusCanvasContainer *
 	for (node = container->details->icons; node != NULL; node = node->next) {
 		icon = node->data;
 
-		if (invalidate_labels) {
+		if (invalidate_labels && icon->item != NULL) {
 			nautilus_canvas_item_invalidate_label (icon->item);
 		}
 
@@ -3973,6 +4317,9 @@ style_updated (GtkWidget *widget)
 		GTK_WIDGET_CLASS (nautilus_canvas_container_parent_class)->style_updated (widget);
 	}
 
+	/* The font or its rendering may have changed. */
+	g_hash_table_remove_all (container->details->label_sizes);
+
 	if (gtk_widget_get_realized (widget)) {
 		nautilus_canvas_container_request_update_all_internal (container, TRUE);
 	}
@@ -5105,7 +5452,7 @@ update_selected (NautilusCanvasContainer *container)
 	
 	for (node = container->details->icons; node != NULL; node = node->next) {
 		icon = node->data;
-		if (icon->is_selected) {
+		if (icon->is_selected && icon->item != NULL) {
 			eel_canvas_item_request_update (EEL_CANVAS_ITEM (icon->item));
 		}
 	}
@@ -5216,6 +5563,8 @@ nautilus_canvas_container_init (NautilusCanvasContainer *container)
 	details = g_new0 (NautilusCanvasContainerDetails, 1);
 
 	details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	details->label_sizes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	details->selection_valid = TRUE;
 	details->layout_timestamp = UNDEFINED_TIME;
 	details->zoom_level = NAUTILUS_CANVAS_ZOOM_LEVEL_STANDARD;
 
@@ -5447,6 +5796,8 @@ nautilus_canvas_container_clear (NautilusCanvasContainer *container)
 	details = container->details;
 	details->layout_timestamp = UNDEFINED_TIME;
 	details->store_layout_timestamps_when_finishing_new_icons = FALSE;
+	details->virtualized = FALSE;
+	destroy_item_pool (container);
 
 	if (details->icons == NULL) {
 		return;
@@ -5468,9 +5819,14 @@ nautilus_canvas_container_clear (NautilusCanvasContainer *container)
 	details->new_icons = NULL;
 	g_list_free (details->selection);
 	details->selection = NULL;
+	details->selection_count = 0;
+	details->selection_valid = TRUE;
+	details->layout_valid = FALSE;
+	details->layout_last_icon = NULL;
 
  	g_hash_table_destroy (details->icon_set);
  	details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_clear_pointer (&details->icons_by_uri, g_hash_table_destroy);
  
 	nautilus_canvas_container_update_scroll_region (container);
 }
@@ -5516,8 +5872,8 @@ nautilus_canvas_container_get_first_visible_icon (NautilusCanvasContainer *conta
 		icon = l->data;
 
 		if (icon_is_positioned (icon)) {
-			eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-						    &x1, &y1, &x2, &y2);
+			icon_get_bounds (icon, &x1, &y1, &x2, &y2,
+					 BOUNDS_USAGE_FOR_DISPLAY);
 
 			compare_lt = FALSE;
 			if (nautilus_canvas_container_is_layout_vertical (container)) {
@@ -5584,7 +5940,7 @@ nautilus_canvas_container_scroll_to_canvas (NautilusCanvasContainer  *container,
 				/* ensure that we reveal the entire row/column */
 				icon_get_row_and_column_bounds (container, icon, &bounds);
 			} else {
-				item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), &bounds);
+				icon_get_canvas_bounds (container, icon, &bounds);
 			}
 
 			if (nautilus_canvas_container_is_layout_vertical (container)) {
@@ -5662,14 +6018,20 @@ icon_destroy (NautilusCanvasContainer *container,
  
 	details = container->details;
 
-	item = g_list_find (details->icons, icon);
-	item = item->next ? item->next : item->prev;
+	item = icon->link->next ? icon->link->next : icon->link->prev;
 	icon_to_focus = (item != NULL) ? item->data : NULL;
  
-	details->icons = g_list_remove (details->icons, icon);
+	details->icons = g_list_delete_link (details->icons, icon->link);
+	icon->link = NULL;
 	details->new_icons = g_list_remove (details->new_icons, icon);
-	details->selection = g_list_remove (details->selection, icon->data);
+	if (icon->is_selected) {
+		details->selection_count--;
+		invalidate_selection (container);
+	}
 	g_hash_table_remove (details->icon_set, icon->data);
+	if (details->icons_by_uri != NULL) {
+		icon_unindex_uri (container, icon);
+	}
 
 	was_selected = icon->is_selected;
 
@@ -5809,16 +6171,148 @@ nautilus_canvas_container_prioritize_thumbnailing (NautilusCanvasContainer *cont
 	klass->prioritize_thumbnailing (container, icon->data);
 }
 
+static NautilusCanvasItem *
+canvas_item_new (NautilusCanvasContainer *container)
+{
+	EelCanvasItem *item, *band;
+
+	item = eel_canvas_item_new (EEL_CANVAS_GROUP (EEL_CANVAS (container)->root),
+				    nautilus_canvas_item_get_type (),
+				    "visible", FALSE,
+				    NULL);
+
+	/* Make sure the icon is under the selection_rectangle */
+	band = container->details->rubberband_info.selection_rectangle;
+	if (band) {
+		eel_canvas_item_send_behind (item, band);
+	}
+
+	g_signal_connect_object (item, "event",
+				 G_CALLBACK (item_event_callback), container, 0);
+
+	return NAUTILUS_CANVAS_ITEM (item);
+}
+
+/* Give the icon a canvas item, recycling one from the pool if possible.
+ * The item is not shown, so it can be used for measuring as well.
+ */
+static void
+icon_bind_item (NautilusCanvasContainer *container,
+		NautilusCanvasIcon *icon)
+{
+	NautilusCanvasItem *item;
+	double x, y;
+
+	g_assert (icon->item == NULL);
+
+	item = g_queue_pop_head (&container->details->item_pool);
+	if (item == NULL) {
+		item = canvas_item_new (container);
+	}
+
+	item->user_data = icon;
+	icon->item = item;
+
+	icon_get_origin (icon, &x, &y);
+	eel_canvas_item_move (EEL_CANVAS_ITEM (item), x, y);
+
+	icon_update_item (container, icon);
+	eel_canvas_item_set (EEL_CANVAS_ITEM (item),
+			     "highlighted_for_selection", (gboolean) icon->is_selected,
+			     "highlighted_as_keyboard_focus",
+			     icon == container->details->focus && container->details->keyboard_focus,
+			     "highlighted_for_clipboard", (gboolean) icon->is_highlighted_for_clipboard,
+			     NULL);
+	nautilus_canvas_item_set_entire_text (item, icon->entire_text);
+}
+
+/* Save the geometry of the icon and put its canvas item back into the pool. */
+static void
+icon_release_item (NautilusCanvasContainer *container,
+		   NautilusCanvasIcon *icon)
+{
+	NautilusCanvasItem *item;
+	double x, y;
+
+	item = icon->item;
+
+	/* The layout bounds are remembered for the ellipsized label,
+	 * icon_get_bounds() accounts for the entire text.
+	 */
+	nautilus_canvas_item_set_entire_text (item, FALSE);
+	icon_save_geometry (icon);
+
+	icon->item = NULL;
+	item->user_data = NULL;
+
+	if (g_queue_get_length (&container->details->item_pool) >= ITEM_POOL_SIZE) {
+		eel_canvas_item_destroy (EEL_CANVAS_ITEM (item));
+		return;
+	}
+
+	eel_canvas_item_hide (EEL_CANVAS_ITEM (item));
+	eel_canvas_item_set (EEL_CANVAS_ITEM (item),
+			     "highlighted_for_selection", FALSE,
+			     "highlighted_as_keyboard_focus", FALSE,
+			     "highlighted_for_drop", FALSE,
+			     "highlighted_for_clipboard", FALSE,
+			     NULL);
+	nautilus_canvas_item_set_is_visible (item, FALSE);
+	nautilus_canvas_item_set_image (item, NULL);
+
+	icon_get_origin (icon, &x, &y);
+	eel_canvas_item_move (EEL_CANVAS_ITEM (item), -x, -y);
+
+	g_queue_push_head (&container->details->item_pool, item);
+}
+
+static void
+icon_ensure_item (NautilusCanvasContainer *container,
+		  NautilusCanvasIcon *icon)
+{
+	if (icon->item == NULL) {
+		icon_bind_item (container, icon);
+		eel_canvas_item_show (EEL_CANVAS_ITEM (icon->item));
+	}
+}
+
+/* Icons the user is interacting with keep their canvas item even when
+ * they are scrolled out of view.
+ */
+static gboolean
+icon_is_pinned (NautilusCanvasContainer *container,
+		NautilusCanvasIcon *icon)
+{
+	NautilusCanvasContainerDetails *details;
+
+	details = container->details;
+
+	return icon == details->focus
+		|| icon == details->stretch_icon
+		|| icon == details->drag_icon;
+}
+
+static void
+destroy_item_pool (NautilusCanvasContainer *container)
+{
+	NautilusCanvasItem *item;
+
+	while ((item = g_queue_pop_head (&container->details->item_pool)) != NULL) {
+		eel_canvas_item_destroy (EEL_CANVAS_ITEM (item));
+	}
+}
+
 static void
 nautilus_canvas_container_update_visible_icons (NautilusCanvasContainer *container)
 {
 	GtkAdjustment *vadj, *hadj;
 	double min_y, max_y;
 	double min_x, max_x;
+	double margin_x, margin_y;
 	double x0, y0, x1, y1;
-	GList *node;
+	GList *node, *near_icons, *visible_icons;
 	NautilusCanvasIcon *icon;
-	gboolean visible;
+	gboolean visible, near;
 	GtkAllocation allocation;
 
 	hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
@@ -5835,6 +6329,14 @@ nautilus_canvas_container_update_visible_icons (NautilusCanvasContainer *contain
 			min_x, min_y, &min_x, &min_y);
 	eel_canvas_c2w (EEL_CANVAS (container),
 			max_x, max_y, &max_x, &max_y);
+
+	/* In virtualized mode, icons up to a page away keep their canvas
+	 * items so scrolling does not rebuild them all the time.
+	 */
+	margin_x = max_x - min_x;
+	margin_y = max_y - min_y;
+	near_icons = NULL;
+	visible_icons = NULL;
 	
 	/* Do the iteration in reverse to get the render-order from top to
 	 * bottom for the prioritized thumbnails.
@@ -5843,33 +6345,54 @@ nautilus_canvas_container_update_visible_icons (NautilusCanvasContainer *contain
 		icon = node->data;
 
 		if (icon_is_positioned (icon)) {
-			eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-						    &x0,
-						    &y0,
-						    &x1,
-						    &y1);
-			eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-					     &x0,
-					     &y0);
-			eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-					     &x1,
-					     &y1);
+			/* Canvas items are in the root group, so these are
+			 * world coordinates already.
+			 */
+			icon_get_bounds (icon, &x0, &y0, &x1, &y1,
+					 BOUNDS_USAGE_FOR_DISPLAY);
 
 			if (nautilus_canvas_container_is_layout_vertical (container)) {
 				visible = x1 >= min_x && x0 <= max_x;
+				near = x1 >= min_x - margin_x && x0 <= max_x + margin_x;
 			} else {
 				visible = y1 >= min_y && y0 <= max_y;
+				near = y1 >= min_y - margin_y && y0 <= max_y + margin_y;
+			}
+
+			if (container->details->virtualized) {
+				if (icon->item == NULL && visible) {
+					visible_icons = g_list_prepend (visible_icons, icon);
+				} else if (icon->item == NULL && near) {
+					near_icons = g_list_prepend (near_icons, icon);
+				} else if (icon->item != NULL && !near && !icon_is_pinned (container, icon)) {
+					icon_release_item (container, icon);
+				}
 			}
 
+			if (icon->item != NULL) {
+				nautilus_canvas_item_set_is_visible (icon->item, visible);
+			}
 			if (visible) {
-				nautilus_canvas_item_set_is_visible (icon->item, TRUE);
 				nautilus_canvas_container_prioritize_thumbnailing (container,
 										   icon);
-			} else {
-				nautilus_canvas_item_set_is_visible (icon->item, FALSE);
 			}
 		}
 	}
+
+	/* Bind after releasing, so the items of the icons that went out of
+	 * view are the ones reused.
+	 */
+	for (node = visible_icons; node != NULL; node = node->next) {
+		icon = node->data;
+
+		icon_ensure_item (container, icon);
+		nautilus_canvas_item_set_is_visible (icon->item, TRUE);
+	}
+	for (node = near_icons; node != NULL; node = node->next) {
+		icon_ensure_item (container, node->data);
+	}
+	g_list_free (visible_icons);
+	g_list_free (near_icons);
 }
 
 static void
@@ -5894,6 +6417,32 @@ handle_hadjustment_changed (GtkAdjustment *adjustment,
 void 
 nautilus_canvas_container_update_icon (NautilusCanvasContainer *container,
 					 NautilusCanvasIcon *icon)
+{
+	if (icon == NULL) {
+		return;
+	}
+
+	/* The text or the image may have changed; measure it again on
+	 * the next layout.
+	 */
+	icon->has_layout_size = FALSE;
+
+	if (icon->item == NULL) {
+		/* Measure the icon with a recycled canvas item; binding
+		 * updates it. It gets an item of its own once it is near
+		 * the visible area.
+		 */
+		icon_bind_item (container, icon);
+		icon_release_item (container, icon);
+		return;
+	}
+
+	icon_update_item (container, icon);
+}
+
+static void
+icon_update_item (NautilusCanvasContainer *container,
+		  NautilusCanvasIcon *icon)
 {
 	NautilusCanvasContainerDetails *details;
 	guint icon_size;
@@ -5901,10 +6450,6 @@ nautilus_canvas_container_update_icon (NautilusCanvasContainer *container,
 	NautilusIconInfo *icon_info;
 	GdkPixbuf *pixbuf;
 	char *editable_text, *additional_text;
-	
-	if (icon == NULL) {
-		return;
-	}
 
 	details = container->details;
 
@@ -5980,10 +6525,9 @@ finish_adding_icon (NautilusCanvasContainer *container,
 		    NautilusCanvasIcon *icon)
 {
 	nautilus_canvas_container_update_icon (container, icon);
-	eel_canvas_item_show (EEL_CANVAS_ITEM (icon->item));
-
-	g_signal_connect_object (icon->item, "event",
-				 G_CALLBACK (item_event_callback), container, 0);
+	if (icon->item != NULL) {
+		eel_canvas_item_show (EEL_CANVAS_ITEM (icon->item));
+	}
 
 	g_signal_emit (container, signals[ICON_ADDED], 0, icon->data);
 }
@@ -6128,7 +6672,6 @@ nautilus_canvas_container_add (NautilusCanvasContainer *container,
 {
 	NautilusCanvasContainerDetails *details;
 	NautilusCanvasIcon *icon;
-	EelCanvasItem *band, *item;
 	
 	g_return_val_if_fail (NAUTILUS_IS_CANVAS_CONTAINER (container), FALSE);
 	g_return_val_if_fail (data != NULL, FALSE);
@@ -6151,25 +6694,33 @@ nautilus_canvas_container_add (NautilusCanvasContainer *container,
 	 */
 	icon->has_lazy_position = is_old_or_unknown_icon_data (container, data);
 	icon->scale = 1.0;
- 	icon->item = NAUTILUS_CANVAS_ITEM
-		(eel_canvas_item_new (EEL_CANVAS_GROUP (EEL_CANVAS (container)->root),
-				      nautilus_canvas_item_get_type (),
-				      "visible", FALSE,
-				      NULL));
-	icon->item->user_data = icon;
 
-	/* Make sure the icon is under the selection_rectangle */
-	item = EEL_CANVAS_ITEM (icon->item);
-	band = NAUTILUS_CANVAS_CONTAINER (item->canvas)->details->rubberband_info.selection_rectangle;
-	if (band) {
-		eel_canvas_item_send_behind (item, band);
+	/* Large grid layouts only create canvas items for the icons near
+	 * the visible area. Once on, this stays on until the container is
+	 * cleared; the existing items get released on the next layout.
+	 */
+	if (!details->virtualized
+	    && details->auto_layout
+	    && !details->is_desktop
+	    && !details->is_fixed_size
+	    && g_hash_table_size (details->icon_set) >= VIRTUALIZE_ICON_COUNT) {
+		details->virtualized = TRUE;
+	}
+
+	if (!details->virtualized) {
+		icon->item = canvas_item_new (container);
+		icon->item->user_data = icon;
 	}
 	
 	/* Put it on both lists. */
 	details->icons = g_list_prepend (details->icons, icon);
 	details->new_icons = g_list_prepend (details->new_icons, icon);
+	icon->link = details->icons;
 
 	g_hash_table_insert (details->icon_set, data, icon);
+	if (details->icons_by_uri != NULL) {
+		icon_index_uri (container, icon);
+	}
 
 	details->needs_resort = TRUE;
 
@@ -6242,6 +6793,12 @@ nautilus_canvas_container_request_update (NautilusCanvasContainer *container,
 	icon = g_hash_table_lookup (container->details->icon_set, data);
 
 	if (icon != NULL) {
+		/* The file may have been renamed. */
+		if (container->details->icons_by_uri != NULL) {
+			icon_unindex_uri (container, icon);
+			icon_index_uri (container, icon);
+		}
+
 		nautilus_canvas_container_update_icon (container, icon);
 		container->details->needs_resort = TRUE;
 		schedule_redo_layout (container);
@@ -6330,13 +6887,43 @@ nautilus_canvas_container_reveal (NautilusCanvasContainer *container, NautilusCa
 GList *
 nautilus_canvas_container_get_selection (NautilusCanvasContainer *container)
 {
+	NautilusCanvasContainerDetails *details;
+	GList *p;
+
 	g_return_val_if_fail (NAUTILUS_IS_CANVAS_CONTAINER (container), NULL);
 
-	if (container->details->selection_needs_resort) {
-		sort_selection (container);
+	details = container->details;
+
+	/* Selecting or unselecting icons only flips their bits; the list
+	 * is built once per change, when somebody asks for it.
+	 */
+	if (!details->selection_valid) {
+		if (details->selection_count > 0) {
+			for (p = details->icons; p != NULL; p = p->next) {
+				NautilusCanvasIcon *icon;
+
+				icon = p->data;
+				if (icon->is_selected) {
+					details->selection = g_list_prepend (details->selection, icon->data);
+				}
+			}
+			sort_selection (container);
+		}
+		details->selection_valid = TRUE;
 	}
 
-	return g_list_copy (container->details->selection);
+	return g_list_copy (details->selection);
+}
+
+/* Cheaper than nautilus_canvas_container_get_selection() when only the
+ * number of selected icons matters.
+ */
+int
+nautilus_canvas_container_get_selection_count (NautilusCanvasContainer *container)
+{
+	g_return_val_if_fail (NAUTILUS_IS_CANVAS_CONTAINER (container), 0);
+
+	return container->details->selection_count;
 }
 
 static GList *
@@ -6655,31 +7242,17 @@ nautilus_canvas_container_get_icon_by_uri (NautilusCanvasContainer *container,
 	NautilusCanvasContainerDetails *details;
 	GList *p;
 
-	/* Eventually, we must avoid searching the entire canvas list,
-	   but it's OK for now.
-	   A hash table mapping uri to canvas is one possibility.
-	*/
-
 	details = container->details;
 
-	for (p = details->icons; p != NULL; p = p->next) {
-		NautilusCanvasIcon *icon;
-		char *icon_uri;
-		gboolean is_match;
-
-		icon = p->data;
-
-		icon_uri = nautilus_canvas_container_get_icon_uri
-			(container, icon);
-		is_match = strcmp (uri, icon_uri) == 0;
-		g_free (icon_uri);
-
-		if (is_match) {
-			return icon;
+	/* Only index the icons once somebody looks for one. */
+	if (details->icons_by_uri == NULL) {
+		details->icons_by_uri = g_hash_table_new (g_str_hash, g_str_equal);
+		for (p = details->icons; p != NULL; p = p->next) {
+			icon_index_uri (container, p->data);
 		}
 	}
 
-	return NULL;
+	return g_hash_table_lookup (details->icons_by_uri, uri);
 }
 
 static NautilusCanvasIcon *
@@ -6768,6 +7341,7 @@ nautilus_canvas_container_show_stretch_handles (NautilusCanvasContainer *contain
 		ungrab_stretch_icon (container);
 		emit_stretch_ended (container, details->stretch_icon);
 	}
+	icon_ensure_item (container, icon);
 	nautilus_canvas_item_set_show_stretch_handles (icon->item, TRUE);
 	details->stretch_icon = icon;
 	
@@ -6923,6 +7497,35 @@ nautilus_canvas_container_get_icon_drop_target_uri (NautilusCanvasContainer *con
 	return uri;
 }
 
+EelDRect
+nautilus_canvas_container_get_icon_rectangle (NautilusCanvasContainer *container,
+					      NautilusCanvasIcon *icon)
+{
+	return icon_get_icon_rectangle (icon);
+}
+
+/* Like nautilus_canvas_item_hit_test_rectangle(), but also works for
+ * icons that currently have no canvas item.
+ */
+gboolean
+nautilus_canvas_container_hit_test_icon (NautilusCanvasContainer *container,
+					 NautilusCanvasIcon *icon,
+					 EelIRect canvas_rect)
+{
+	EelIRect icon_rect;
+
+	if (icon->item != NULL) {
+		return nautilus_canvas_item_hit_test_rectangle (icon->item, canvas_rect);
+	}
+
+	if (!icon_is_positioned (icon)) {
+		return FALSE;
+	}
+
+	icon_get_canvas_bounds (container, icon, &icon_rect);
+	return eel_irect_hits_irect (icon_rect, canvas_rect);
+}
+
 /* Call to reset the scroll region only if the container is not empty,
  * to avoid having the flag linger until the next file is added.
  */
@@ -6951,6 +7554,7 @@ nautilus_canvas_container_set_auto_layout (NautilusCanvasContainer *container,
 
 	reset_scroll_region_if_not_empty (container);
 	container->details->auto_layout = auto_layout;
+	container->details->layout_valid = FALSE;
 
 	if (!auto_layout) {
 		reload_icon_positions (container);
@@ -7202,9 +7806,12 @@ nautilus_canvas_container_set_highlighted_for_clipboard (NautilusCanvasContainer
 		icon = l->data;
 		highlighted_for_clipboard = (g_list_find (clipboard_canvas_data, icon->data) != NULL);
 
-		eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
-				     "highlighted-for-clipboard", highlighted_for_clipboard,
-				     NULL);
+		icon->is_highlighted_for_clipboard = highlighted_for_clipboard;
+		if (icon->item != NULL) {
+			eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
+					     "highlighted-for-clipboard", highlighted_for_clipboard,
+					     NULL);
+		}
 	}
 
 }
@@ -7362,8 +7969,9 @@ nautilus_canvas_container_accessible_icon_added_cb (NautilusCanvasContainer *con
 	icon = g_hash_table_lookup (container->details->icon_set, icon_data);
 	if (icon) {
 		atk_parent = ATK_OBJECT (data);
-		atk_child = atk_gobject_accessible_for_object 
-			(G_OBJECT (icon->item));
+		/* Icons without a canvas item have no accessible yet. */
+		atk_child = icon->item != NULL ?
+			atk_gobject_accessible_for_object (G_OBJECT (icon->item)) : NULL;
 		
 		g_signal_emit_by_name (atk_parent, "children-changed::add",
 				       icon->position, atk_child, NULL);
@@ -7382,8 +7990,9 @@ nautilus_canvas_container_accessible_icon_removed_cb (NautilusCanvasContainer *c
 	icon = g_hash_table_lookup (container->details->icon_set, icon_data);
 	if (icon) {
 		atk_parent = ATK_OBJECT (data);
-		atk_child = atk_gobject_accessible_for_object 
-			(G_OBJECT (icon->item));
+		/* Icons without a canvas item have no accessible yet. */
+		atk_child = icon->item != NULL ?
+			atk_gobject_accessible_for_object (G_OBJECT (icon->item)) : NULL;
 		
 		g_signal_emit_by_name (atk_parent, "children-changed::remove",
 				       icon->position, atk_child, NULL);
@@ -7453,17 +8062,20 @@ nautilus_canvas_container_accessible_ref_selection (AtkSelection *accessible,
 						    int i)
 {
 	NautilusCanvasContainerAccessiblePrivate *priv;
+	NautilusCanvasContainer *container;
 	AtkObject *atk_object;
 	GList *item;
 	NautilusCanvasIcon *icon;
 
 	nautilus_canvas_container_accessible_update_selection (ATK_OBJECT (accessible));
 	priv = GET_ACCESSIBLE_PRIV (accessible);
+	container = NAUTILUS_CANVAS_CONTAINER (gtk_accessible_get_widget (GTK_ACCESSIBLE (accessible)));
 
 	item = (g_list_nth (priv->selection, i));
 
 	if (item) {
 		icon = item->data;
+		icon_ensure_item (container, icon);
 		atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
 		if (atk_object) {
 			g_object_ref (atk_object);
@@ -7638,7 +8250,8 @@ nautilus_canvas_container_accessible_ref_child (AtkObject *accessible, int i)
         
         if (item) {
                 icon = item->data;
-                
+
+                icon_ensure_item (container, icon);
                 atk_object = atk_gobject_accessible_for_object (G_OBJECT (icon->item));
                 g_object_ref (atk_object);
 
@@ -265,6 +265,7 @@ void              nautilus_canvas_container_select_first                  (Nauti
 
 /* operations on the selection */
 GList     *       nautilus_canvas_container_get_selection                 (NautilusCanvasContainer  *view);
+int               nautilus_canvas_container_get_selection_count           (NautilusCanvasContainer  *view);
 void			  nautilus_canvas_container_invert_selection				(NautilusCanvasContainer  *view);
 void              nautilus_canvas_container_set_selection                 (NautilusCanvasContainer  *view,
 									   GList                  *selection);
@@ -232,7 +232,7 @@ icon_get_data_binder (NautilusCanvasIcon *icon, gpointer data)
 
 	container = NAUTILUS_CANVAS_CONTAINER (context->iterator_context);
 
-	world_rect = nautilus_canvas_item_get_icon_rectangle (icon->item);
+	world_rect = nautilus_canvas_container_get_icon_rectangle (container, icon);
 
 	canvas_rect_world_to_widget (EEL_CANVAS (container), &world_rect, &widget_rect);
 
@@ -601,7 +601,7 @@ nautilus_canvas_container_item_at (NautilusCanvasContainer *container,
 				point.y1,
 				&canvas_point.x1,
 				&canvas_point.y1);
-		if (nautilus_canvas_item_hit_test_rectangle (icon->item, canvas_point)) {
+		if (nautilus_canvas_container_hit_test_icon (container, icon, canvas_point)) {
 			return icon;
 		}
 	}
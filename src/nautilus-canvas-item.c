@@ -58,6 +58,9 @@
 #define MAX_TEXT_WIDTH_LARGE 98
 #define MAX_TEXT_WIDTH_LARGER 100
 
+/* Number of label sizes the container keeps, see measure_label() */
+#define LABEL_SIZE_CACHE_MAX 4096
+
 /* special text height handling
  * each item has three text height variables:
  *  + text_height: actual height of the displayed (i.e. on-screen) PangoLayout.
@@ -169,6 +172,8 @@ static void     draw_pixbuf                          (GdkPixbuf
 						      cairo_t                       *cr,
 						      int                            x,
 						      int                            y);
+static PangoLayout *create_label_layout              (NautilusCanvasItem            *item,
+						      const char                    *text);
 static PangoLayout *get_label_layout                 (PangoLayout                  **layout,
 						      NautilusCanvasItem        *item,
 						      const char                    *text);
@@ -712,24 +717,13 @@ prepare_pango_layout_width (NautilusCanvasItem *item,
 	pango_layout_set_ellipsize (layout, PANGO_ELLIPSIZE_END);
 }
 
-static void
-prepare_pango_layout_for_measure_entire_text (NautilusCanvasItem *item,
-					      PangoLayout *layout)
-{
-	prepare_pango_layout_width (item, layout);
-	pango_layout_set_height (layout, G_MININT);
-}
-
-static void
-prepare_pango_layout_for_draw (NautilusCanvasItem *item,
-			       PangoLayout *layout)
+static int
+get_label_layout_height_for_draw (NautilusCanvasItem *item)
 {
 	NautilusCanvasItemDetails *details;
 	NautilusCanvasContainer *container;
 	gboolean needs_highlight;
 
-	prepare_pango_layout_width (item, layout);
-
 	container = NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
 	details = item->details;
 
@@ -739,26 +733,93 @@ prepare_pango_layout_for_draw (NautilusCanvasItem *item,
 	    details->is_highlighted_as_keyboard_focus ||
 	    details->entire_text) {
 		/* VOODOO-TODO, cf. compute_text_rectangle() */
-		pango_layout_set_height (layout, G_MININT);
+		return G_MININT;
 	} else {
 		/* TODO? we might save some resources, when the re-layout is not neccessary in case
 		 * the layout height already fits into max. layout lines. But pango should figure this
 		 * out itself (which it doesn't ATM).
 		 */
-		pango_layout_set_height (layout,
-					 nautilus_canvas_container_get_max_layout_lines_for_pango (container));
+		return nautilus_canvas_container_get_max_layout_lines_for_pango (container);
 	}
 }
 
+static void
+prepare_pango_layout_for_draw (NautilusCanvasItem *item,
+			       PangoLayout *layout)
+{
+	prepare_pango_layout_width (item, layout);
+	pango_layout_set_height (layout, get_label_layout_height_for_draw (item));
+}
+
+/* Measure @text the way it is laid out with the given height, all of it
+ * if @entire_text is set. The sizes are shared by all items of the
+ * container, so labels that are the same are only shaped once; the
+ * returned sizes are only valid until the next call.
+ *
+ * The item's own layout is used if it has one, but measuring does not
+ * create one to keep; only items that get drawn hold a PangoLayout.
+ */
+static const NautilusCanvasLabelSize *
+measure_label (NautilusCanvasItem *item,
+	       PangoLayout *cached_layout,
+	       const char *text,
+	       gboolean entire_text)
+{
+	NautilusCanvasContainer *container;
+	GHashTable *label_sizes;
+	NautilusCanvasLabelSize *size;
+	PangoLayout *layout;
+	int width, height, max_layout_lines;
+	char *key;
+
+	container = NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
+	label_sizes = container->details->label_sizes;
+
+	width = floor (nautilus_canvas_item_get_max_text_width (item)) * PANGO_SCALE;
+	height = entire_text ? G_MININT : get_label_layout_height_for_draw (item);
+	max_layout_lines = nautilus_canvas_container_get_max_layout_lines (container);
+
+	key = g_strdup_printf ("%s\n%d\n%d\n%d\n%s",
+			       container->details->font != NULL ? container->details->font : "",
+			       width, height, max_layout_lines, text);
+
+	size = g_hash_table_lookup (label_sizes, key);
+	if (size != NULL) {
+		g_free (key);
+		return size;
+	}
+
+	if (cached_layout != NULL) {
+		layout = g_object_ref (cached_layout);
+	} else {
+		layout = create_label_layout (item, text);
+	}
+
+	prepare_pango_layout_width (item, layout);
+	pango_layout_set_height (layout, height);
+
+	size = g_new0 (NautilusCanvasLabelSize, 1);
+	layout_get_full_size (layout, &size->width, &size->height, &size->dx);
+	layout_get_size_for_layout (layout, max_layout_lines,
+				    size->height, &size->height_for_layout);
+
+	g_object_unref (layout);
+
+	if (g_hash_table_size (label_sizes) >= LABEL_SIZE_CACHE_MAX) {
+		g_hash_table_remove_all (label_sizes);
+	}
+	g_hash_table_insert (label_sizes, key, size);
+
+	return size;
+}
+
 static void
 measure_label_text (NautilusCanvasItem *item)
 {
 	NautilusCanvasItemDetails *details;
-	NautilusCanvasContainer *container;
 	gint editable_height, editable_height_for_layout, editable_height_for_entire_text, editable_width, editable_dx;
 	gint additional_height, additional_width, additional_dx;
-	PangoLayout *editable_layout;
-	PangoLayout *additional_layout;
+	const NautilusCanvasLabelSize *size;
 	gboolean have_editable, have_additional;
 
 	/* check to see if the cached values are still valid; if so, there's
@@ -801,39 +862,26 @@ measure_label_text (NautilusCanvasItem *item)
 	additional_height = 0;
 	additional_dx = 0;
 
-	container = NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);	
-	editable_layout = NULL;
-	additional_layout = NULL;
-
 	if (have_editable) {
 		/* first, measure required text height: editable_height_for_entire_text
 		 * then, measure text height applicable for layout: editable_height_for_layout
 		 * next, measure actually displayed height: editable_height
 		 */
-		editable_layout = get_label_layout (&details->editable_text_layout, item, details->editable_text);
-
-		prepare_pango_layout_for_measure_entire_text (item, editable_layout);
-		layout_get_full_size (editable_layout,
-				      NULL,
-				      &editable_height_for_entire_text,
-				      NULL);
-		layout_get_size_for_layout (editable_layout,
-					    nautilus_canvas_container_get_max_layout_lines (container),
-					    editable_height_for_entire_text,
-					    &editable_height_for_layout);
+		size = measure_label (item, details->editable_text_layout, details->editable_text, TRUE);
+		editable_height_for_entire_text = size->height;
+		editable_height_for_layout = size->height_for_layout;
 
-		prepare_pango_layout_for_draw (item, editable_layout);
-		layout_get_full_size (editable_layout,
-				      &editable_width,
-				      &editable_height,
-				      &editable_dx);
+		size = measure_label (item, details->editable_text_layout, details->editable_text, FALSE);
+		editable_width = size->width;
+		editable_height = size->height;
+		editable_dx = size->dx;
 	}
 
 	if (have_additional) {
-		additional_layout = get_label_layout (&details->additional_text_layout, item, details->additional_text);
-		prepare_pango_layout_for_draw (item, additional_layout);
-		layout_get_full_size (additional_layout,
-				      &additional_width, &additional_height, &additional_dx);
+		size = measure_label (item, details->additional_text_layout, details->additional_text, FALSE);
+		additional_width = size->width;
+		additional_height = size->height;
+		additional_dx = size->dx;
 	}
 
 	details->editable_text_height = editable_height;
@@ -866,14 +914,6 @@ measure_label_text (NautilusCanvasItem *item)
 
 	/* extra to make it look nicer */
 	details->text_width += TEXT_BACK_PADDING_X*2;
-
-	if (editable_layout) {
-		g_object_unref (editable_layout);
-	}
-
-	if (additional_layout) {
-		g_object_unref (additional_layout);
-	}
 }
 
 static void
@@ -1975,6 +2015,11 @@ nautilus_canvas_item_accessible_idle_do_action (gpointer data)
 		g_free (ctx);
 		icon = item->user_data;
 
+		/* The icon may have released the item in the meantime. */
+		if (icon == NULL) {
+			continue;
+		}
+
 		switch (action_number) {
 		case ACTION_OPEN:
 			file_list.data = icon->data;
@@ -2202,6 +2247,9 @@ nautilus_canvas_item_accessible_get_image_description (AtkImage *image)
 			return NULL;
 		}
 		icon = item->user_data;
+		if (icon == NULL) {
+			return NULL;
+		}
 		container = NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
 		description = nautilus_canvas_container_get_icon_description (container, icon->data);
 		g_free (priv->description);
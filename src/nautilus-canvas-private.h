@@ -34,9 +34,17 @@ typedef struct {
 	/* Object represented by this icon. */
 	NautilusCanvasIconData *data;
 
-	/* Canvas item for the icon. */
+	/* Canvas item for the icon. In virtualized mode only the icons
+	 * near the visible area have one, see icon_bind_item().
+	 */
 	NautilusCanvasItem *item;
 
+	/* Node of the icon in the icons list of the container. */
+	GList *link;
+
+	/* URI the icon is indexed by in icons_by_uri, if any. */
+	char *uri;
+
 	/* X/Y coordinates. */
 	double x, y;
 
@@ -54,6 +62,28 @@ typedef struct {
 	/* Position in the view */
 	int position;
 
+	/* Geometry relative to (x, y), in world coordinates. Saved when
+	 * the canvas item is released, used as long as there is none.
+	 */
+	EelDRect icon_rect;
+	EelDRect layout_rect;
+	EelDRect entire_rect;
+
+	/* Sizes used by the grid layout, measured once until the icon
+	 * is updated, see icon_ensure_layout_size().
+	 */
+	double layout_width;
+	double layout_height_above;
+	double layout_height_below;
+	double image_width;
+	double image_height;
+
+	/* Where the last grid layout left the icon: the top of its line
+	 * and the icon preceding it.
+	 */
+	double layout_line_y;
+	gconstpointer layout_prev;
+
 	/* Whether this item is selected. */
 	eel_boolean_bit is_selected : 1;
 
@@ -64,6 +94,13 @@ typedef struct {
 	eel_boolean_bit is_visible : 1;
 
 	eel_boolean_bit has_lazy_position : 1;
+
+	/* Item state to restore when a canvas item is bound again. */
+	eel_boolean_bit entire_text : 1;
+	eel_boolean_bit is_highlighted_for_clipboard : 1;
+
+	eel_boolean_bit has_layout_size : 1;
+	eel_boolean_bit starts_line : 1;
 } NautilusCanvasIcon;
 
 
@@ -83,6 +120,14 @@ typedef struct {
 	int last_adj_y;
 } NautilusCanvasRubberbandInfo;
 
+/* Size of a label laid out by Pango, in pixels. */
+typedef struct {
+	int width;
+	int height;
+	int dx;
+	int height_for_layout;
+} NautilusCanvasLabelSize;
+
 typedef enum {
 	DRAG_STATE_INITIAL,
 	DRAG_STATE_MOVE_OR_COPY,
@@ -119,8 +164,14 @@ struct NautilusCanvasContainerDetails {
 	/* List of icons. */
 	GList *icons;
 	GList *new_icons;
+	/* Data of the selected icons, built from their is_selected bits
+	 * when asked for; see nautilus_canvas_container_get_selection().
+	 */
 	GList *selection;
+	int selection_count;
 	GHashTable *icon_set;
+	/* URI to icon, built on the first lookup by URI. */
+	GHashTable *icons_by_uri;
 
 	/* Currently focused icon for accessibility. */
 	NautilusCanvasIcon *focus;
@@ -234,9 +285,27 @@ struct NautilusCanvasContainerDetails {
 	guint a11y_item_action_idle_handler;
 	GQueue* a11y_item_action_queue;
 
+	/* Only icons near the visible area have canvas items, the
+	 * others are recycled through item_pool.
+	 */
+	gboolean virtualized;
+	GQueue item_pool;
+
+	/* State of the last grid layout of all icons, used to only lay
+	 * out the lines that changed since.
+	 */
+	gboolean layout_valid;
+	double layout_width;
+	gconstpointer layout_last_icon;
+
+	/* NautilusCanvasLabelSize for each text, font and layout size
+	 * measured by the items, see measure_label().
+	 */
+	GHashTable *label_sizes;
+
 	eel_boolean_bit is_loading : 1;
 	eel_boolean_bit needs_resort : 1;
-	eel_boolean_bit selection_needs_resort : 1;
+	eel_boolean_bit selection_valid : 1;
 
 	eel_boolean_bit store_layout_timestamps : 1;
 	eel_boolean_bit store_layout_timestamps_when_finishing_new_icons : 1;
@@ -264,6 +333,11 @@ char *        nautilus_canvas_container_get_icon_drop_target_uri    (NautilusCan
 								       NautilusCanvasIcon          *canvas);
 void          nautilus_canvas_container_update_icon                 (NautilusCanvasContainer *container,
 								       NautilusCanvasIcon          *canvas);
+EelDRect      nautilus_canvas_container_get_icon_rectangle          (NautilusCanvasContainer *container,
+								       NautilusCanvasIcon          *icon);
+gboolean      nautilus_canvas_container_hit_test_icon               (NautilusCanvasContainer *container,
+								       NautilusCanvasIcon          *icon,
+								       EelIRect                     canvas_rect);
 gboolean      nautilus_canvas_container_scroll                      (NautilusCanvasContainer *container,
 								     int                    delta_x,
 								     int                    delta_y);
@@ -106,6 +106,8 @@ nautilus_canvas_view_container_prioritize_thumbnailing (NautilusCanvasContainer
 		nautilus_thumbnail_prioritize (uri);
 		g_free (uri);
 	}
+
+	nautilus_file_prioritize_extension_info (file);
 }
 
 static GQuark *
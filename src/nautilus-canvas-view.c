@@ -874,6 +874,15 @@ nautilus_canvas_view_get_selection (NautilusFilesView *view)
 	return list;
 }
 
+static guint
+nautilus_canvas_view_get_selection_count (NautilusFilesView *view)
+{
+	g_return_val_if_fail (NAUTILUS_IS_CANVAS_VIEW (view), 0);
+
+	return nautilus_canvas_container_get_selection_count
+		(get_canvas_container (NAUTILUS_CANVAS_VIEW (view)));
+}
+
 static void
 action_reversed_order (GSimpleAction *action,
 		       GVariant      *state,
@@ -1385,6 +1394,27 @@ canvas_container_context_click_background_callback (NautilusCanvasContainer *con
 	nautilus_files_view_pop_up_background_context_menu (NAUTILUS_FILES_VIEW (canvas_view), event);
 }
 
+/* Laying out or cleaning up a folder reports the position of every
+ * icon, most of them unchanged; only queue writes for those that moved.
+ */
+static void
+set_metadata_if_changed (NautilusFile *file,
+			 const char *key,
+			 const char *default_metadata,
+			 const char *metadata)
+{
+	char *old_metadata;
+	const char *new_metadata;
+
+	new_metadata = metadata != NULL ? metadata : default_metadata;
+
+	old_metadata = nautilus_file_get_metadata (file, key, NULL);
+	if (g_strcmp0 (old_metadata, new_metadata) != 0) {
+		nautilus_file_set_metadata (file, key, default_metadata, metadata);
+	}
+	g_free (old_metadata);
+}
+
 static void
 icon_position_changed_callback (NautilusCanvasContainer *container,
 				NautilusFile *file,
@@ -1402,7 +1432,7 @@ icon_position_changed_callback (NautilusCanvasContainer *container,
 	if (!nautilus_canvas_view_using_auto_layout (canvas_view)) {
 		position_string = g_strdup_printf
 			("%d,%d", position->x, position->y);
-		nautilus_file_set_metadata
+		set_metadata_if_changed
 			(file, NAUTILUS_METADATA_KEY_ICON_POSITION, 
 			 NULL, position_string);
 		g_free (position_string);
@@ -1410,7 +1440,7 @@ icon_position_changed_callback (NautilusCanvasContainer *container,
 
 
 	g_ascii_dtostr (scale_string, sizeof (scale_string), position->scale);
-	nautilus_file_set_metadata
+	set_metadata_if_changed
 		(file, NAUTILUS_METADATA_KEY_ICON_SCALE,
 		 "1.0", scale_string);
 }
@@ -1901,6 +1931,7 @@ nautilus_canvas_view_class_init (NautilusCanvasViewClass *klass)
 	nautilus_files_view_class->compute_rename_popover_relative_to = nautilus_canvas_view_compute_rename_popover_relative_to;
 	nautilus_files_view_class->get_selection = nautilus_canvas_view_get_selection;
 	nautilus_files_view_class->get_selection_for_file_transfer = nautilus_canvas_view_get_selection;
+	nautilus_files_view_class->get_selection_count = nautilus_canvas_view_get_selection_count;
 	nautilus_files_view_class->is_empty = nautilus_canvas_view_is_empty;
 	nautilus_files_view_class->remove_file = nautilus_canvas_view_remove_file;
 	nautilus_files_view_class->restore_default_zoom_level = nautilus_canvas_view_restore_default_zoom_level;
@@ -146,6 +146,7 @@ get_extension_columns (void)
 	GList *columns;
 	GList *providers;
 	GList *l;
+	gint64 start_time;
 	
 	providers = nautilus_module_get_extensions_for_type (NAUTILUS_TYPE_COLUMN_PROVIDER);
 	
@@ -156,7 +157,9 @@ get_extension_columns (void)
 		GList *provider_columns;
 		
 		provider = NAUTILUS_COLUMN_PROVIDER (l->data);
+		start_time = g_get_monotonic_time ();
 		provider_columns = nautilus_column_provider_get_columns (provider);
+		nautilus_module_record_call (provider, NAUTILUS_MODULE_INTERFACE_COLUMN, start_time);
 		columns = g_list_concat (columns, provider_columns);
 	}
 
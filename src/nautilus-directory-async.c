@@ -23,13 +23,19 @@
 
 #include "nautilus-directory-notify.h"
 #include "nautilus-directory-private.h"
+#include "nautilus-directory-snapshot.h"
 #include "nautilus-file-attributes.h"
 #include "nautilus-file-private.h"
 #include "nautilus-file-utilities.h"
 #include "nautilus-signaller.h"
 #include "nautilus-global-preferences.h"
 #include "nautilus-link.h"
+#include "nautilus-module.h"
 #include "nautilus-profile.h"
+
+#define DEBUG_FLAG NAUTILUS_DEBUG_EXTENSIONS
+#include "nautilus-debug.h"
+
 #include <eel/eel-glib-extensions.h>
 #include <gtk/gtk.h>
 #include <libxml/parser.h>
@@ -53,8 +59,24 @@
 
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 
+/* Past this many new files at once, reading the whole folder again is
+ * cheaper than querying each of them */
+#define NEW_FILES_BULK_THRESHOLD 100
+
+/* Extension info providers run concurrently, up to this many calls per
+ * directory. Providers that take a list of files get up to
+ * EXTENSION_INFO_BATCH_SIZE of them per call, one call at a time.
+ */
+#define EXTENSION_INFO_MAX_REQUESTS 8
+#define EXTENSION_INFO_BATCH_SIZE 64
+/* Calls taking longer than this are reported in the debug output */
+#define EXTENSION_INFO_BUDGET_MSEC 100
+
 /* Keep async. jobs down to this number for all directories. */
 #define MAX_ASYNC_JOBS 10
+/* Directories nobody but the prefetcher wants only get to start jobs
+ * while fewer than this many are running and nothing else is waiting. */
+#define MAX_BACKGROUND_ASYNC_JOBS 2
 
 struct TopLeftTextReadState {
 	NautilusDirectory *directory;
@@ -117,6 +139,14 @@ struct NewFilesState {
 	int count;
 };
 
+struct NewFilesBulkState {
+	NautilusDirectory *directory;
+	GCancellable *cancellable;
+	GFileEnumerator *enumerator;
+	GHashTable *names;
+	gboolean rescan;
+};
+
 struct DirectoryCountState {
 	NautilusDirectory *directory;
 	NautilusFile *count_file;
@@ -159,12 +189,19 @@ typedef struct {
 	Request request;
 } Monitor;
 
+/* Holds a ref on its files until the provider is done with them. The
+ * provider completes through @update_complete, which carries the request
+ * itself and is invalidated once the request goes away.
+ */
 typedef struct {
 	NautilusDirectory *directory;
 	NautilusInfoProvider *provider;
 	NautilusOperationHandle *handle;
-	NautilusOperationResult result;
-} InfoProviderResponse;
+	GClosure *update_complete;
+	GList *files;
+	guint idle;
+	gint64 start_time;
+} ExtensionInfoRequest;
 
 typedef gboolean (* RequestCheck) (Request);
 typedef gboolean (* FileCheck) (NautilusFile *);
@@ -331,6 +368,36 @@ nautilus_directory_verify_request_counts (NautilusDirectory *directory)
 }
 #endif
 
+/* Only being prefetched, nothing on screen is waiting for it */
+static gboolean
+is_background_directory (NautilusDirectory *directory)
+{
+	return directory->details->prefetch_requests > 0 &&
+		directory->details->monitor_list == NULL &&
+		g_list_length (directory->details->call_when_ready_list) ==
+		(guint) directory->details->prefetch_requests;
+}
+
+static gboolean
+foreground_directories_waiting (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	if (waiting_directories == NULL) {
+		return FALSE;
+	}
+
+	g_hash_table_iter_init (&iter, waiting_directories);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		if (!is_background_directory (value)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 /* Start a job. This is really just a way of limiting the number of
  * async. requests that we issue at any given time. Without this, the
  * number of requests is unbounded.
@@ -350,7 +417,10 @@ async_job_start (NautilusDirectory *directory,
 	g_assert (async_job_count >= 0);
 	g_assert (async_job_count <= MAX_ASYNC_JOBS);
 
-	if (async_job_count >= MAX_ASYNC_JOBS) {
+	if (async_job_count >= MAX_ASYNC_JOBS ||
+	    (is_background_directory (directory) &&
+	     (async_job_count >= MAX_BACKGROUND_ASYNC_JOBS ||
+	      foreground_directories_waiting ()))) {
 		if (waiting_directories == NULL) {
 			waiting_directories = g_hash_table_new (NULL, NULL);
 		}
@@ -420,27 +490,33 @@ async_job_end (NautilusDirectory *directory,
 	async_job_count -= 1;
 }
 
-/* Helper to get one value from a hash table. */
-static void
-get_one_value_callback (gpointer key, gpointer value, gpointer callback_data)
+/* Pick the next waiting directory that may start a job, the ones
+ * views are waiting for before the prefetched ones. */
+static NautilusDirectory *
+get_waiting_directory (void)
 {
-	gpointer *returned_value;
+	GHashTableIter iter;
+	gpointer value;
+	NautilusDirectory *background;
 
-	returned_value = callback_data;
-	*returned_value = value;
-}
+	if (waiting_directories == NULL) {
+		return NULL;
+	}
 
-/* return a single value from a hash table. */
-static gpointer
-get_one_value (GHashTable *table)
-{
-	gpointer value;
+	background = NULL;
+	g_hash_table_iter_init (&iter, waiting_directories);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		if (!is_background_directory (value)) {
+			return value;
+		}
+		background = value;
+	}
 
-	value = NULL;
-	if (table != NULL) {
-		g_hash_table_foreach (table, get_one_value_callback, &value);
+	if (async_job_count >= MAX_BACKGROUND_ASYNC_JOBS) {
+		return NULL;
 	}
-	return value;
+
+	return background;
 }
 
 /* Wake up directories that are "blocked" as long as there are job
@@ -461,7 +537,7 @@ async_job_wake_up (void)
 	
 	already_waking_up = TRUE;
 	while (async_job_count < MAX_ASYNC_JOBS) {
-		value = get_one_value (waiting_directories);
+		value = get_waiting_directory ();
 		if (value == NULL) {
 			break;
 		}
@@ -568,6 +644,12 @@ new_files_cancel (NautilusDirectory *directory)
 		g_list_free (directory->details->new_files_in_progress);
 		directory->details->new_files_in_progress = NULL;
 	}
+
+	if (directory->details->new_files_bulk_in_progress != NULL) {
+		g_cancellable_cancel (directory->details->new_files_bulk_in_progress->cancellable);
+		directory->details->new_files_bulk_in_progress->directory = NULL;
+		directory->details->new_files_bulk_in_progress = NULL;
+	}
 }
 
 static int
@@ -900,6 +982,7 @@ dequeue_pending_idle_callback (gpointer callback_data)
 			/* file already exists in dir, check if we still need to
 			 *  emit file_added or if it changed */
 			set_file_unconfirmed (file, FALSE);
+			file->details->from_snapshot = FALSE;
 			if (!file->details->is_added) {
 				/* We consider this newly added even if its in the list.
 				 * This can happen if someone called nautilus_file_get_by_uri()
@@ -1073,10 +1156,14 @@ directory_load_done (NautilusDirectory *directory,
 		 * We clear the unconfirmed bit on each file here so that
 		 * they won't be marked "gone" later -- we don't know enough
 		 * about them to know whether they are really gone.
+		 * What we only had from a snapshot goes away though,
+		 * it is not worth showing without the real thing.
 		 */
 		for (node = directory->details->file_list;
 		     node != NULL; node = node->next) {
-			set_file_unconfirmed (NAUTILUS_FILE (node->data), FALSE);
+			if (!NAUTILUS_FILE (node->data)->details->from_snapshot) {
+				set_file_unconfirmed (NAUTILUS_FILE (node->data), FALSE);
+			}
 		}
 
 		nautilus_directory_emit_load_error (directory, error);
@@ -1088,6 +1175,10 @@ directory_load_done (NautilusDirectory *directory,
 	}
 	dequeue_pending_idle_callback (directory);
 
+	if (error == NULL) {
+		nautilus_directory_snapshot_save (directory);
+	}
+
 	directory_load_cancel (directory);
 
         g_object_unref (directory);
@@ -1460,9 +1551,188 @@ new_files_callback (GObject *source_object,
 	nautilus_directory_unref (directory);
 }
 
-void
-nautilus_directory_get_info_for_new_files (NautilusDirectory *directory,
-					   GList *location_list)
+static void new_files_bulk_start (NewFilesBulkState *state);
+static void new_files_query_each (NautilusDirectory *directory,
+				  GList *location_list);
+
+static void
+new_files_bulk_state_free (NewFilesBulkState *state)
+{
+	if (state->directory != NULL) {
+		state->directory->details->new_files_bulk_in_progress = NULL;
+	}
+
+	g_clear_object (&state->enumerator);
+	g_object_unref (state->cancellable);
+	g_hash_table_destroy (state->names);
+	g_free (state);
+}
+
+/* Queries the files still waiting one by one, for when the folder can't
+ * be read. Frees @state. */
+static void
+new_files_bulk_query_remaining (NewFilesBulkState *state)
+{
+	NautilusDirectory *directory;
+	GHashTableIter iter;
+	gpointer name;
+	GList *locations;
+
+	directory = state->directory;
+
+	locations = NULL;
+	g_hash_table_iter_init (&iter, state->names);
+	while (g_hash_table_iter_next (&iter, &name, NULL)) {
+		locations = g_list_prepend (locations,
+					    g_file_get_child (directory->details->location, name));
+	}
+	new_files_bulk_state_free (state);
+
+	new_files_query_each (directory, locations);
+	g_list_free_full (locations, g_object_unref);
+}
+
+static void
+new_files_bulk_more_files_callback (GObject *source_object,
+				    GAsyncResult *res,
+				    gpointer user_data)
+{
+	NewFilesBulkState *state;
+	NautilusDirectory *directory;
+	GList *files, *l;
+	GFileInfo *info;
+	const char *name;
+	GError *error;
+
+	state = user_data;
+
+	if (state->directory == NULL) {
+		/* Operation was cancelled. Bail out */
+		new_files_bulk_state_free (state);
+		return;
+	}
+
+	directory = nautilus_directory_ref (state->directory);
+
+	error = NULL;
+	files = g_file_enumerator_next_files_finish (state->enumerator, res, &error);
+
+	/* Load the new files, and whatever else we didn't know about */
+	for (l = files; l != NULL; l = l->next) {
+		info = l->data;
+		name = g_file_info_get_name (info);
+
+		if (name != NULL &&
+		    (g_hash_table_remove (state->names, name) ||
+		     nautilus_directory_find_file_by_name (directory, name) == NULL)) {
+			directory_load_one (directory, info);
+		}
+		g_object_unref (info);
+	}
+
+	if (error != NULL) {
+		/* The rest of the folder can't be read, don't lose the files
+		 * that were announced but not reached yet */
+		g_error_free (error);
+		new_files_bulk_query_remaining (state);
+	} else if (files != NULL) {
+		g_file_enumerator_next_files_async (state->enumerator,
+						    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+						    G_PRIORITY_DEFAULT,
+						    state->cancellable,
+						    new_files_bulk_more_files_callback,
+						    state);
+	} else if (state->rescan && g_hash_table_size (state->names) > 0) {
+		/* Some files were announced after the enumeration went past
+		 * them. The names still left are those, or files already gone. */
+		g_clear_object (&state->enumerator);
+		new_files_bulk_start (state);
+	} else {
+		new_files_bulk_state_free (state);
+	}
+
+	g_list_free (files);
+
+	nautilus_directory_unref (directory);
+}
+
+static void
+new_files_bulk_enumerate_callback (GObject *source_object,
+				   GAsyncResult *res,
+				   gpointer user_data)
+{
+	NewFilesBulkState *state;
+
+	state = user_data;
+
+	state->enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
+							      res, NULL);
+
+	if (state->directory == NULL) {
+		new_files_bulk_state_free (state);
+		return;
+	}
+
+	if (state->enumerator == NULL) {
+		/* Fall back to querying the files one by one */
+		new_files_bulk_query_remaining (state);
+		return;
+	}
+
+	g_file_enumerator_next_files_async (state->enumerator,
+					    DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+					    G_PRIORITY_DEFAULT,
+					    state->cancellable,
+					    new_files_bulk_more_files_callback,
+					    state);
+}
+
+static void
+new_files_bulk_start (NewFilesBulkState *state)
+{
+	state->rescan = FALSE;
+
+	g_file_enumerate_children_async (state->directory->details->location,
+					 NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
+					 0,
+					 G_PRIORITY_DEFAULT,
+					 state->cancellable,
+					 new_files_bulk_enumerate_callback,
+					 state);
+}
+
+/* Big bursts of new files are picked up by reading the folder again,
+ * which costs about the same however many files there are. Files added
+ * while that is running are merged into it.
+ */
+static void
+new_files_bulk_add (NautilusDirectory *directory,
+		    GList *location_list)
+{
+	NewFilesBulkState *state;
+	GList *l;
+
+	state = directory->details->new_files_bulk_in_progress;
+	if (state == NULL) {
+		state = g_new0 (NewFilesBulkState, 1);
+		state->directory = directory;
+		state->cancellable = g_cancellable_new ();
+		state->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+		directory->details->new_files_bulk_in_progress = state;
+		new_files_bulk_start (state);
+	} else {
+		state->rescan = TRUE;
+	}
+
+	for (l = location_list; l != NULL; l = l->next) {
+		g_hash_table_add (state->names, g_file_get_basename (l->data));
+	}
+}
+
+static void
+new_files_query_each (NautilusDirectory *directory,
+		      GList *location_list)
 {
 	NewFilesState *state;
 	GFile *location;
@@ -1495,6 +1765,22 @@ nautilus_directory_get_info_for_new_files (NautilusDirectory *directory,
 				  state);
 }
 
+void
+nautilus_directory_get_info_for_new_files (NautilusDirectory *directory,
+					   GList *location_list)
+{
+	if (location_list == NULL) {
+		return;
+	}
+
+	if (directory->details->new_files_bulk_in_progress != NULL ||
+	    g_list_length (location_list) >= NEW_FILES_BULK_THRESHOLD) {
+		new_files_bulk_add (directory, location_list);
+	} else {
+		new_files_query_each (directory, location_list);
+	}
+}
+
 void
 nautilus_async_destroying_file (NautilusFile *file)
 {
@@ -1561,10 +1847,6 @@ nautilus_async_destroying_file (NautilusFile *file)
 		directory->details->link_info_read_state->file = NULL;
 		changed = TRUE;
 	}
-	if (directory->details->extension_info_file == file) {
-		directory->details->extension_info_file = NULL;
-		changed = TRUE;
-	}
 
 	if (directory->details->thumbnail_state != NULL &&
 	    directory->details->thumbnail_state->file ==  file) {
@@ -2024,6 +2306,37 @@ enumerate_children_callback (GObject *source_object,
 }
 
 
+/* Show the files from the last listing we saved right away, as
+ * unconfirmed ones. The real listing then confirms, updates or removes
+ * them like it does for files we already knew about.
+ */
+static void
+add_files_from_snapshot (NautilusDirectory *directory)
+{
+	GList *infos, *l;
+	GList *added_files;
+	NautilusFile *file;
+
+	infos = nautilus_directory_snapshot_load (directory);
+	if (infos == NULL) {
+		return;
+	}
+
+	added_files = NULL;
+	for (l = infos; l != NULL; l = l->next) {
+		file = nautilus_file_new_from_info (directory, l->data);
+		nautilus_directory_add_file (directory, file);
+		set_file_unconfirmed (file, TRUE);
+		file->details->from_snapshot = TRUE;
+		file->details->is_added = TRUE;
+		added_files = g_list_prepend (added_files, file);
+	}
+	g_list_free_full (infos, g_object_unref);
+
+	nautilus_directory_emit_files_added (directory, added_files);
+	nautilus_file_list_free (added_files);
+}
+
 /* Start monitoring the file list if it isn't already. */
 static void
 start_monitoring_file_list (NautilusDirectory *directory)
@@ -2047,6 +2360,10 @@ start_monitoring_file_list (NautilusDirectory *directory)
 
 	mark_all_files_unconfirmed (directory);
 
+	if (directory->details->file_list == NULL) {
+		add_files_from_snapshot (directory);
+	}
+
 	state = g_new0 (DirectoryLoadState, 1);
 	state->directory = directory;
 	state->cancellable = g_cancellable_new ();
@@ -4051,44 +4368,103 @@ filesystem_info_start (NautilusDirectory *directory,
 	g_object_unref (location);
 }
 
-static void
-extension_info_cancel (NautilusDirectory *directory)
+static gboolean
+extension_info_in_flight (NautilusDirectory *directory,
+			  NautilusFile *file)
 {
-	if (directory->details->extension_info_in_progress != NULL) {
-		if (directory->details->extension_info_idle) {
-			g_source_remove (directory->details->extension_info_idle);
-		} else {
-			nautilus_info_provider_cancel_update 
-				(directory->details->extension_info_provider,
-				 directory->details->extension_info_in_progress);
-		}
+	return directory->details->extension_info_files != NULL &&
+		g_hash_table_lookup (directory->details->extension_info_files, file) != NULL;
+}
 
-		directory->details->extension_info_in_progress = NULL;
-		directory->details->extension_info_file = NULL;
-		directory->details->extension_info_provider = NULL;
-		directory->details->extension_info_idle = 0;
+static gboolean
+provider_handles_batches (NautilusInfoProvider *provider)
+{
+	return NAUTILUS_INFO_PROVIDER_GET_IFACE (provider)->update_file_info_batch != NULL;
+}
 
+/* The first request of a directory takes an async. job for all of them */
+static gboolean
+extension_info_request_begin (NautilusDirectory *directory)
+{
+	if (directory->details->extension_info_requests != NULL) {
+		return TRUE;
+	}
+
+	return async_job_start (directory, "extension info");
+}
+
+/* Unlinks @request from the directory, returning its files */
+static GList *
+extension_info_request_remove (NautilusDirectory *directory,
+			       ExtensionInfoRequest *request)
+{
+	GList *files, *l;
+
+	directory->details->extension_info_requests =
+		g_list_remove (directory->details->extension_info_requests, request);
+
+	if (request->idle != 0) {
+		g_source_remove (request->idle);
+	}
+	/* Late or repeated completions must not reach the freed request */
+	g_closure_invalidate (request->update_complete);
+	g_closure_unref (request->update_complete);
+
+	files = request->files;
+	for (l = files; l != NULL; l = l->next) {
+		g_hash_table_remove (directory->details->extension_info_files, l->data);
+	}
+	g_free (request);
+
+	if (directory->details->extension_info_requests == NULL) {
 		async_job_end (directory, "extension info");
 	}
+
+	return files;
+}
+
+static void
+extension_info_request_cancel (NautilusDirectory *directory,
+			       ExtensionInfoRequest *request)
+{
+	if (request->idle == 0 && request->handle != NULL) {
+		nautilus_info_provider_cancel_update (request->provider,
+						      request->handle);
+	}
+
+	nautilus_file_list_free (extension_info_request_remove (directory, request));
+}
+
+static void
+extension_info_cancel (NautilusDirectory *directory)
+{
+	while (directory->details->extension_info_requests != NULL) {
+		extension_info_request_cancel (directory,
+					       directory->details->extension_info_requests->data);
+	}
 }
 	
 static void
 extension_info_stop (NautilusDirectory *directory)
 {
-	if (directory->details->extension_info_in_progress != NULL) {
-		NautilusFile *file;
+	ExtensionInfoRequest *request;
+	GList *l, *next, *f;
+	gboolean wanted;
 
-		file = directory->details->extension_info_file;
-		if (file != NULL) {
-			g_assert (NAUTILUS_IS_FILE (file));
-			g_assert (file->details->directory == directory);
-			if (is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO)) {
-				return;
-			}
+	for (l = directory->details->extension_info_requests; l != NULL; l = next) {
+		next = l->next;
+		request = l->data;
+
+		wanted = FALSE;
+		for (f = request->files; f != NULL && !wanted; f = f->next) {
+			g_assert (NAUTILUS_IS_FILE (f->data));
+			wanted = is_needy (f->data, lacks_extension_info, REQUEST_EXTENSION_INFO);
 		}
 
 		/* The info is not wanted, so stop it. */
-		extension_info_cancel (directory);
+		if (!wanted) {
+			extension_info_request_cancel (directory, request);
+		}
 	}
 }
 
@@ -4109,32 +4485,38 @@ finish_info_provider (NautilusDirectory *directory,
 	}
 }
 
-
-static gboolean
-info_provider_idle_callback (gpointer user_data)
+static void
+extension_info_request_done (NautilusDirectory *directory,
+			     ExtensionInfoRequest *request)
 {
-	InfoProviderResponse *response;
-	NautilusDirectory *directory;
-
-	response = user_data;
-	directory = response->directory;
+	NautilusInfoProvider *provider;
+	GList *files, *l;
+	gint64 elapsed;
 
-	if (response->handle != directory->details->extension_info_in_progress
-	    || response->provider != directory->details->extension_info_provider) {
-		g_warning ("Unexpected plugin response.  This probably indicates a bug in a Nautilus extension: handle=%p", response->handle);
-	} else {
-		NautilusFile *file;
-		async_job_end (directory, "extension info");
+	provider = request->provider;
 
-		file = directory->details->extension_info_file;
+	elapsed = (g_get_monotonic_time () - request->start_time) / 1000;
+	DEBUG ("%s: %u file(s) in %" G_GINT64_FORMAT " ms%s",
+	       G_OBJECT_TYPE_NAME (provider),
+	       g_list_length (request->files),
+	       elapsed,
+	       elapsed > EXTENSION_INFO_BUDGET_MSEC ? ", over budget" : "");
 
-		directory->details->extension_info_file = NULL;
-		directory->details->extension_info_provider = NULL;
-		directory->details->extension_info_in_progress = NULL;
-		directory->details->extension_info_idle = 0;
-		
-		finish_info_provider (directory, file, response->provider);
+	files = extension_info_request_remove (directory, request);
+	for (l = files; l != NULL; l = l->next) {
+		finish_info_provider (directory, l->data, provider);
 	}
+	nautilus_file_list_free (files);
+}
+
+static gboolean
+info_provider_idle_callback (gpointer user_data)
+{
+	ExtensionInfoRequest *request;
+
+	request = user_data;
+	request->idle = 0;
+	extension_info_request_done (request->directory, request);
 
 	return FALSE;
 }
@@ -4145,69 +4527,186 @@ info_provider_callback (NautilusInfoProvider *provider,
 			NautilusOperationResult result,
 			gpointer user_data)
 {
-	InfoProviderResponse *response;
-	
-	response = g_new0 (InfoProviderResponse, 1);
-	response->provider = provider;
-	response->handle = handle;
-	response->result = result;
-	response->directory = NAUTILUS_DIRECTORY (user_data);
+	ExtensionInfoRequest *request;
 
-	response->directory->details->extension_info_idle =
-		g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-				 info_provider_idle_callback, response,
-				 g_free);
+	request = user_data;
+
+	/* Providers may complete before returning the handle, or more
+	 * than once; the first completion finishes the request. */
+	if (request->idle == 0) {
+		request->idle = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+						 info_provider_idle_callback,
+						 request,
+						 NULL);
+	}
 }
 
-static void
-extension_info_start (NautilusDirectory *directory,
-		      NautilusFile *file,
-		      gboolean *doing_io)
+/* Returns FALSE if the provider was done right away */
+static gboolean
+extension_info_start_request (NautilusDirectory *directory,
+			      NautilusInfoProvider *provider,
+			      GList *files)
 {
-	NautilusInfoProvider *provider;
+	ExtensionInfoRequest *request;
 	NautilusOperationResult result;
 	NautilusOperationHandle *handle;
 	GClosure *update_complete;
+	GList *l;
 
-	if (directory->details->extension_info_in_progress != NULL) {
-		*doing_io = TRUE;
-		return;
+	if (directory->details->extension_info_files == NULL) {
+		directory->details->extension_info_files = g_hash_table_new (NULL, NULL);
 	}
-	
-	if (!is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO)) {
-		return;
-	}
-	*doing_io = TRUE;
 
-	if (!async_job_start (directory, "extension info")) {
-		return;
-	}
+	request = g_new0 (ExtensionInfoRequest, 1);
+	request->directory = directory;
+	request->provider = provider;
+	request->files = files;
+	request->start_time = g_get_monotonic_time ();
 
-	provider = file->details->pending_info_providers->data;
+	for (l = files; l != NULL; l = l->next) {
+		g_hash_table_insert (directory->details->extension_info_files, l->data, request);
+	}
+	directory->details->extension_info_requests =
+		g_list_prepend (directory->details->extension_info_requests, request);
 
 	update_complete = g_cclosure_new (G_CALLBACK (info_provider_callback),
-					  directory,
+					  request,
 					  NULL);
 	g_closure_set_marshal (update_complete,
 			       g_cclosure_marshal_generic);
-			       
-	result = nautilus_info_provider_update_file_info
-		(provider, 
-		 NAUTILUS_FILE_INFO (file), 
-		 update_complete, 
-		 &handle);
+	request->update_complete = update_complete;
 
-	g_closure_unref (update_complete);
+	handle = NULL;
+	if (provider_handles_batches (provider)) {
+		result = nautilus_info_provider_update_file_info_batch
+			(provider, files, update_complete, &handle);
+	} else {
+		result = nautilus_info_provider_update_file_info
+			(provider,
+			 NAUTILUS_FILE_INFO (files->data),
+			 update_complete,
+			 &handle);
+	}
+	/* Only the time spent blocking the main loop counts here */
+	nautilus_module_record_call (provider, NAUTILUS_MODULE_INTERFACE_INFO, request->start_time);
 
 	if (result == NAUTILUS_OPERATION_COMPLETE ||
 	    result == NAUTILUS_OPERATION_FAILED) {
-		finish_info_provider (directory, file, provider);
-		async_job_end (directory, "extension info");
-	} else {
-		directory->details->extension_info_in_progress = handle;
-		directory->details->extension_info_provider = provider;
-		directory->details->extension_info_file = file;
+		extension_info_request_done (directory, request);
+		return FALSE;
 	}
+
+	request->handle = handle;
+	return TRUE;
+}
+
+static gboolean
+extension_info_provider_busy (NautilusDirectory *directory,
+			      NautilusInfoProvider *provider)
+{
+	GList *l;
+
+	for (l = directory->details->extension_info_requests; l != NULL; l = l->next) {
+		if (((ExtensionInfoRequest *) l->data)->provider == provider) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* The files from @queue_link on that @provider still has to look at */
+static GList *
+collect_extension_info_batch (NautilusDirectory *directory,
+			      GList *queue_link,
+			      NautilusInfoProvider *provider)
+{
+	NautilusFile *file;
+	GList *files;
+	int count;
+
+	files = NULL;
+	count = 0;
+	for (; queue_link != NULL && count < EXTENSION_INFO_BATCH_SIZE; queue_link = queue_link->next) {
+		file = queue_link->data;
+
+		if (!extension_info_in_flight (directory, file) &&
+		    g_list_find (file->details->pending_info_providers, provider) != NULL &&
+		    is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO)) {
+			files = g_list_prepend (files, nautilus_file_ref (file));
+			count++;
+		}
+	}
+
+	return g_list_reverse (files);
+}
+
+/* Goes over the extension queue in order, which puts the files the views
+ * asked for first, and keeps up to EXTENSION_INFO_MAX_REQUESTS provider
+ * calls going.
+ */
+static void
+extension_info_start (NautilusDirectory *directory,
+		      gboolean *doing_io)
+{
+	NautilusInfoProvider *provider;
+	NautilusFile *file;
+	GList *files;
+	GList *l;
+
+	for (l = nautilus_file_queue_peek (directory->details->extension_queue);
+	     l != NULL;
+	     l = l->next) {
+		if (g_list_length (directory->details->extension_info_requests) >= EXTENSION_INFO_MAX_REQUESTS) {
+			break;
+		}
+
+		file = l->data;
+		if (extension_info_in_flight (directory, file) ||
+		    !is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO)) {
+			continue;
+		}
+
+		provider = file->details->pending_info_providers->data;
+		/* Providers the watchdog demoted get one call at a time */
+		if (nautilus_module_provider_is_demoted (provider, NAUTILUS_MODULE_INTERFACE_INFO) &&
+		    extension_info_provider_busy (directory, provider)) {
+			continue;
+		}
+
+		if (provider_handles_batches (provider)) {
+			if (extension_info_provider_busy (directory, provider)) {
+				continue;
+			}
+			files = collect_extension_info_batch (directory, l, provider);
+		} else {
+			files = g_list_prepend (NULL, nautilus_file_ref (file));
+		}
+
+		*doing_io = TRUE;
+
+		if (!extension_info_request_begin (directory)) {
+			nautilus_file_list_free (files);
+			return;
+		}
+
+		if (!extension_info_start_request (directory, provider, files)) {
+			/* Finishing may have changed the queue, we get called
+			 * again for the rest. */
+			return;
+		}
+	}
+
+	if (directory->details->extension_info_requests != NULL) {
+		*doing_io = TRUE;
+	}
+}
+
+void
+nautilus_directory_prioritize_file_in_work_queue (NautilusDirectory *directory,
+						  NautilusFile *file)
+{
+	nautilus_file_queue_prioritize (directory->details->extension_queue, file);
 }
 
 static void
@@ -4266,12 +4765,13 @@ start_or_stop_io (NautilusDirectory *directory)
 	}
 
 	/* Low priority queue must be empty */
+	extension_info_start (directory, &doing_io);
+
 	while (!nautilus_file_queue_is_empty (directory->details->extension_queue)) {
 		file = nautilus_file_queue_head (directory->details->extension_queue);
 
-		/* Start getting attributes if possible */
-		extension_info_start (directory, file, &doing_io);
-		if (doing_io) {
+		if (extension_info_in_flight (directory, file) ||
+		    is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO)) {
 			return;
 		}
 
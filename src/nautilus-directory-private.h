@@ -36,6 +36,7 @@ typedef struct DirectoryCountState DirectoryCountState;
 typedef struct DeepCountState DeepCountState;
 typedef struct GetInfoState GetInfoState;
 typedef struct NewFilesState NewFilesState;
+typedef struct NewFilesBulkState NewFilesBulkState;
 typedef struct MimeListState MimeListState;
 typedef struct ThumbnailState ThumbnailState;
 typedef struct MountState MountState;
@@ -102,6 +103,7 @@ struct NautilusDirectoryDetails
         guint dequeue_pending_idle_id;
 
 	GList *new_files_in_progress; /* list of NewFilesState * */
+	NewFilesBulkState *new_files_bulk_in_progress;
 
 	DirectoryCountState *count_in_progress;
 
@@ -113,10 +115,8 @@ struct NautilusDirectoryDetails
 	NautilusFile *get_info_file;
 	GetInfoState *get_info_in_progress;
 
-	NautilusFile *extension_info_file;
-	NautilusInfoProvider *extension_info_provider;
-	NautilusOperationHandle *extension_info_in_progress;
-	guint extension_info_idle;
+	GList *extension_info_requests; /* list of ExtensionInfoRequest * */
+	GHashTable *extension_info_files; /* NautilusFile -> ExtensionInfoRequest */
 
 	ThumbnailState *thumbnail_state;
 
@@ -127,6 +127,11 @@ struct NautilusDirectoryDetails
 	LinkInfoReadState *link_info_read_state;
 
 	GList *file_operations_in_progress; /* list of FileOperation * */
+
+	/* Loaded ahead of time, see nautilus_directory_prefetch(). One
+	 * entry per prefetch, and the number of distinct clients. */
+	GList *prefetch_clients;
+	int prefetch_requests;
 };
 
 NautilusDirectory *nautilus_directory_get_existing                    (GFile                     *location);
@@ -223,6 +228,8 @@ void               nautilus_directory_add_file_to_work_queue          (NautilusD
 								       NautilusFile *file);
 void               nautilus_directory_remove_file_from_work_queue     (NautilusDirectory *directory,
 								       NautilusFile *file);
+void               nautilus_directory_prioritize_file_in_work_queue   (NautilusDirectory *directory,
+								       NautilusFile *file);
 
 
 /* debugging functions */
@@ -0,0 +1,256 @@
+/*
+ * Nautilus
+ *
+ * Nautilus is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Nautilus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; see the file COPYING.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "nautilus-directory-snapshot.h"
+
+#include "nautilus-directory-private.h"
+#include "nautilus-file-private.h"
+#include "nautilus-global-preferences.h"
+#include "nautilus-vfs-directory.h"
+
+#include <glib/gstdio.h>
+
+#define SNAPSHOT_VERSION 1
+/* Listings are read back synchronously, so keep them small */
+#define SNAPSHOT_MAX_FILES 5000
+
+/* (version, [(name, display name, type, size, mtime, content type, icon)]) */
+#define SNAPSHOT_TYPE "(ua(ssuttss))"
+
+static gboolean
+wants_snapshot (NautilusDirectory *directory)
+{
+	if (!g_settings_get_boolean (nautilus_preferences,
+				     NAUTILUS_PREFERENCES_REMOTE_LISTING_SNAPSHOTS)) {
+		return FALSE;
+	}
+
+	if (!NAUTILUS_IS_VFS_DIRECTORY (directory) ||
+	    nautilus_directory_is_in_trash (directory) ||
+	    nautilus_directory_is_in_recent (directory)) {
+		return FALSE;
+	}
+
+	return !g_file_is_native (directory->details->location) ||
+		nautilus_directory_is_remote (directory);
+}
+
+static char *
+get_snapshot_path (NautilusDirectory *directory)
+{
+	char *uri, *checksum, *path;
+
+	uri = nautilus_directory_get_uri (directory);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+	path = g_build_filename (g_get_user_cache_dir (), "nautilus", "listings", checksum, NULL);
+
+	g_free (checksum);
+	g_free (uri);
+
+	return path;
+}
+
+static void
+snapshot_builder_add (GVariantBuilder *builder,
+		      const char *name,
+		      const char *display_name,
+		      GFileType type,
+		      guint64 size,
+		      guint64 mtime,
+		      const char *content_type,
+		      GIcon *icon)
+{
+	char *icon_string;
+
+	icon_string = icon != NULL ? g_icon_to_string (icon) : NULL;
+	g_variant_builder_add (builder, "(ssuttss)",
+			       name,
+			       display_name,
+			       (guint32) type,
+			       size,
+			       mtime,
+			       content_type != NULL ? content_type : "",
+			       icon_string != NULL ? icon_string : "");
+	g_free (icon_string);
+}
+
+GVariant *
+nautilus_directory_snapshot_from_infos (GList *infos)
+{
+	GVariantBuilder builder;
+	GFileInfo *info;
+	GList *l;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssuttss)"));
+	for (l = infos; l != NULL; l = l->next) {
+		info = l->data;
+		snapshot_builder_add (&builder,
+				      g_file_info_get_name (info),
+				      g_file_info_get_display_name (info),
+				      g_file_info_get_file_type (info),
+				      MAX (g_file_info_get_size (info), 0),
+				      g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+				      g_file_info_get_content_type (info),
+				      g_file_info_get_icon (info));
+	}
+
+	return g_variant_new ("(u@a(ssuttss))", SNAPSHOT_VERSION, g_variant_builder_end (&builder));
+}
+
+GList *
+nautilus_directory_snapshot_to_infos (GVariant *snapshot)
+{
+	GVariantIter *iter;
+	GFileInfo *info;
+	GIcon *icon;
+	GList *infos;
+	guint32 version, type;
+	guint64 size, mtime;
+	const char *name, *display_name, *content_type, *icon_string;
+
+	infos = NULL;
+	g_variant_get (snapshot, SNAPSHOT_TYPE, &version, &iter);
+	if (version == SNAPSHOT_VERSION) {
+		while (g_variant_iter_next (iter, "(&s&sutt&s&s)",
+					    &name, &display_name, &type, &size, &mtime,
+					    &content_type, &icon_string)) {
+			info = g_file_info_new ();
+			g_file_info_set_name (info, name);
+			g_file_info_set_display_name (info, display_name);
+			g_file_info_set_file_type (info, type);
+			g_file_info_set_size (info, size);
+			g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+			if (content_type[0] != '\0') {
+				g_file_info_set_content_type (info, content_type);
+			}
+			if (icon_string[0] != '\0') {
+				icon = g_icon_new_for_string (icon_string, NULL);
+				if (icon != NULL) {
+					g_file_info_set_icon (info, icon);
+					g_object_unref (icon);
+				}
+			}
+
+			infos = g_list_prepend (infos, info);
+		}
+	}
+	g_variant_iter_free (iter);
+
+	return g_list_reverse (infos);
+}
+
+GList *
+nautilus_directory_snapshot_load (NautilusDirectory *directory)
+{
+	GVariant *snapshot;
+	GList *infos;
+	char *path, *contents;
+	gsize length;
+
+	if (!wants_snapshot (directory)) {
+		return NULL;
+	}
+
+	path = get_snapshot_path (directory);
+	if (!g_file_get_contents (path, &contents, &length, NULL)) {
+		g_free (path);
+		return NULL;
+	}
+	g_free (path);
+
+	snapshot = g_variant_new_from_data (G_VARIANT_TYPE (SNAPSHOT_TYPE),
+					    contents, length,
+					    FALSE, g_free, contents);
+	g_variant_ref_sink (snapshot);
+
+	infos = nautilus_directory_snapshot_to_infos (snapshot);
+	g_variant_unref (snapshot);
+
+	return infos;
+}
+
+void
+nautilus_directory_snapshot_save (NautilusDirectory *directory)
+{
+	GVariantBuilder builder;
+	GVariant *snapshot;
+	GBytes *bytes;
+	GFile *location;
+	NautilusFile *file;
+	GList *l;
+	char *path, *dirname;
+	guint count;
+
+	if (!wants_snapshot (directory)) {
+		return;
+	}
+
+	path = get_snapshot_path (directory);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssuttss)"));
+	count = 0;
+	for (l = directory->details->file_list; l != NULL; l = l->next) {
+		file = l->data;
+		if (file->details->is_gone || !file->details->got_file_info) {
+			continue;
+		}
+
+		if (++count > SNAPSHOT_MAX_FILES) {
+			break;
+		}
+
+		snapshot_builder_add (&builder,
+				      eel_ref_str_peek (file->details->name),
+				      eel_ref_str_peek (file->details->display_name),
+				      file->details->type,
+				      (guint64) MAX (file->details->size, 0),
+				      (guint64) file->details->mtime,
+				      file->details->mime_type != NULL ? eel_ref_str_peek (file->details->mime_type) : NULL,
+				      file->details->icon);
+	}
+
+	if (count > SNAPSHOT_MAX_FILES) {
+		/* Too big to be any help, don't keep an outdated one around */
+		g_variant_builder_clear (&builder);
+		g_unlink (path);
+		g_free (path);
+		return;
+	}
+
+	snapshot = g_variant_new ("(u@a(ssuttss))", SNAPSHOT_VERSION, g_variant_builder_end (&builder));
+	g_variant_ref_sink (snapshot);
+
+	dirname = g_path_get_dirname (path);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	location = g_file_new_for_path (path);
+	bytes = g_variant_get_data_as_bytes (snapshot);
+	g_file_replace_contents_bytes_async (location,
+					     bytes,
+					     NULL, FALSE,
+					     G_FILE_CREATE_PRIVATE | G_FILE_CREATE_REPLACE_DESTINATION,
+					     NULL, NULL, NULL);
+	g_bytes_unref (bytes);
+	g_object_unref (location);
+	g_variant_unref (snapshot);
+	g_free (path);
+}
@@ -0,0 +1,41 @@
+/*
+ * Nautilus
+ *
+ * Nautilus is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Nautilus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; see the file COPYING.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __NAUTILUS_DIRECTORY_SNAPSHOT_H__
+#define __NAUTILUS_DIRECTORY_SNAPSHOT_H__
+
+#include <gio/gio.h>
+
+#include "nautilus-directory.h"
+
+/* The last complete listing of slow folders, remote and FUSE ones, is
+ * kept on disk so there is something to show while they are read again.
+ */
+
+/* GFileInfos for the files in the last listing of @directory, or NULL */
+GList *nautilus_directory_snapshot_load (NautilusDirectory *directory);
+
+/* Replaces the saved listing with the files @directory has now */
+void   nautilus_directory_snapshot_save (NautilusDirectory *directory);
+
+/* The on-disk form of a listing of GFileInfos, and back */
+GVariant *nautilus_directory_snapshot_from_infos (GList    *infos);
+GList    *nautilus_directory_snapshot_to_infos   (GVariant *snapshot);
+
+#endif /* __NAUTILUS_DIRECTORY_SNAPSHOT_H__ */
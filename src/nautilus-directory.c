@@ -57,6 +57,15 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
 static GHashTable *directories;
 
+/* Folders we navigated away from stay loaded and monitored for a while,
+ * so going back to them or reopening them in a tab doesn't have to
+ * read them all over again. Most recently left first.
+ */
+#define WARM_DIRECTORIES_MAX 8
+#define WARM_DIRECTORIES_MAX_FILES 100000
+
+static GQueue warm_directories = G_QUEUE_INIT;
+
 static void               nautilus_directory_finalize         (GObject                *object);
 static NautilusDirectory *nautilus_directory_new              (GFile                  *location);
 static GList *            real_get_file_list                  (NautilusDirectory      *directory);
@@ -241,6 +250,10 @@ nautilus_directory_finalize (GObject *object)
 	nautilus_file_queue_destroy (directory->details->high_priority_queue);
 	nautilus_file_queue_destroy (directory->details->low_priority_queue);
 	nautilus_file_queue_destroy (directory->details->extension_queue);
+	g_assert (directory->details->extension_info_requests == NULL);
+	if (directory->details->extension_info_files != NULL) {
+		g_hash_table_destroy (directory->details->extension_info_files);
+	}
 	g_assert (directory->details->directory_load_in_progress == NULL);
 	g_assert (directory->details->count_in_progress == NULL);
 	g_assert (directory->details->dequeue_pending_idle_id == 0);
@@ -1638,6 +1651,200 @@ nautilus_directory_force_reload (NautilusDirectory *directory)
 	NAUTILUS_DIRECTORY_CLASS (G_OBJECT_GET_CLASS (directory))->force_reload (directory);
 }
 
+static guint
+get_warm_files_count (void)
+{
+	GList *l;
+	guint count;
+
+	count = 0;
+	for (l = warm_directories.head; l != NULL; l = l->next) {
+		count += g_hash_table_size (NAUTILUS_DIRECTORY (l->data)->details->file_hash);
+	}
+
+	return count;
+}
+
+static void
+release_warm_directory (NautilusDirectory *directory)
+{
+	nautilus_directory_file_monitor_remove (directory, &warm_directories);
+	nautilus_directory_unref (directory);
+}
+
+void
+nautilus_directory_keep_warm (NautilusDirectory *directory)
+{
+	GList *link;
+
+	g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+
+	/* Search results and the like are cheap to throw away or
+	 * wouldn't be right when shown again later anyway */
+	if (!NAUTILUS_IS_VFS_DIRECTORY (directory) ||
+	    !nautilus_directory_are_all_files_seen (directory) ||
+	    g_hash_table_size (directory->details->file_hash) > WARM_DIRECTORIES_MAX_FILES) {
+		return;
+	}
+
+	link = g_queue_find (&warm_directories, directory);
+	if (link != NULL) {
+		g_queue_unlink (&warm_directories, link);
+		g_queue_push_head_link (&warm_directories, link);
+		return;
+	}
+
+	nautilus_directory_ref (directory);
+	nautilus_directory_file_monitor_add (directory, &warm_directories,
+					     TRUE,
+					     NAUTILUS_FILE_ATTRIBUTE_INFO,
+					     NULL, NULL);
+	g_queue_push_head (&warm_directories, directory);
+
+	while (warm_directories.length > WARM_DIRECTORIES_MAX ||
+	       (warm_directories.length > 1 &&
+		get_warm_files_count () > WARM_DIRECTORIES_MAX_FILES)) {
+		release_warm_directory (g_queue_pop_tail (&warm_directories));
+	}
+}
+
+gboolean
+nautilus_directory_is_warm (NautilusDirectory *directory)
+{
+	return g_queue_find (&warm_directories, directory) != NULL;
+}
+
+typedef struct {
+	NautilusDirectory *directory;
+	time_t mtime;
+} RevalidateData;
+
+static void
+revalidate_callback (NautilusFile *file,
+		     gpointer callback_data)
+{
+	RevalidateData *data;
+
+	data = callback_data;
+
+	if (nautilus_file_get_mtime (file) != data->mtime) {
+		nautilus_directory_force_reload (data->directory);
+	}
+
+	nautilus_directory_unref (data->directory);
+	nautilus_file_unref (file);
+	g_slice_free (RevalidateData, data);
+}
+
+/* Checks that a warm directory is still current by looking at the
+ * folder's own modification time, and reloads it only if that moved.
+ * Meant for the folders we don't get change notifications for.
+ */
+void
+nautilus_directory_revalidate (NautilusDirectory *directory)
+{
+	RevalidateData *data;
+	NautilusFile *file;
+
+	g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+
+	file = nautilus_directory_get_corresponding_file (directory);
+
+	data = g_slice_new0 (RevalidateData);
+	data->directory = nautilus_directory_ref (directory);
+	data->mtime = nautilus_file_get_mtime (file);
+
+	nautilus_file_invalidate_attributes (file, NAUTILUS_FILE_ATTRIBUTE_INFO);
+	nautilus_file_call_when_ready (file,
+				       NAUTILUS_FILE_ATTRIBUTE_INFO,
+				       revalidate_callback,
+				       data);
+}
+
+/* Every client holds a reference for each of its prefetches, and one
+ * call_when_ready is pending per client. The folder is not kept warm
+ * once it is read: speculative reads must not push the folders that
+ * were actually visited out of the warm list, so it only stays loaded
+ * while the clients hold on to it.
+ */
+static void
+prefetch_ready_callback (NautilusDirectory *directory,
+			 GList *files,
+			 gpointer callback_data)
+{
+	GList *l;
+	int count;
+
+	count = 0;
+	while ((l = g_list_find (directory->details->prefetch_clients, callback_data)) != NULL) {
+		directory->details->prefetch_clients =
+			g_list_delete_link (directory->details->prefetch_clients, l);
+		count++;
+	}
+	directory->details->prefetch_requests--;
+
+	while (count-- > 0) {
+		nautilus_directory_unref (directory);
+	}
+}
+
+void
+nautilus_directory_prefetch (NautilusDirectory *directory,
+			     gconstpointer client)
+{
+	gboolean pending;
+
+	g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+	g_return_if_fail (client != NULL);
+
+	pending = g_list_find (directory->details->prefetch_clients, client) != NULL;
+	if (!pending &&
+	    (!NAUTILUS_IS_VFS_DIRECTORY (directory) ||
+	     nautilus_directory_are_all_files_seen (directory))) {
+		return;
+	}
+
+	nautilus_directory_ref (directory);
+	directory->details->prefetch_clients =
+		g_list_prepend (directory->details->prefetch_clients, (gpointer) client);
+
+	if (!pending) {
+		directory->details->prefetch_requests++;
+		nautilus_directory_call_when_ready (directory,
+						    NAUTILUS_FILE_ATTRIBUTE_INFO,
+						    TRUE,
+						    prefetch_ready_callback,
+						    (gpointer) client);
+	}
+}
+
+void
+nautilus_directory_cancel_prefetch (NautilusDirectory *directory,
+				    gconstpointer client)
+{
+	GList *l;
+
+	g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+
+	l = g_list_find (directory->details->prefetch_clients, client);
+	if (l == NULL) {
+		return;
+	}
+
+	directory->details->prefetch_clients =
+		g_list_delete_link (directory->details->prefetch_clients, l);
+
+	/* Other clients keep their prefetch going */
+	if (g_list_find (directory->details->prefetch_clients, client) == NULL) {
+		directory->details->prefetch_requests--;
+		nautilus_directory_cancel_callback (directory,
+						    prefetch_ready_callback,
+						    (gpointer) client);
+	}
+
+	nautilus_directory_unref (directory);
+}
+
 gboolean
 nautilus_directory_is_not_empty (NautilusDirectory *directory)
 {
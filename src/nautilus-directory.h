@@ -207,6 +207,24 @@ void               nautilus_directory_file_monitor_remove      (NautilusDirector
 								gconstpointer              client);
 void               nautilus_directory_force_reload             (NautilusDirectory         *directory);
 
+/* Keep a directory we are leaving loaded and monitored for a while, in
+ * case we come back to it. The number of directories and files kept
+ * like this is bounded, the least recently left ones go first.
+ */
+void               nautilus_directory_keep_warm                (NautilusDirectory         *directory);
+gboolean           nautilus_directory_is_warm                  (NautilusDirectory         *directory);
+void               nautilus_directory_revalidate               (NautilusDirectory         *directory);
+
+/* Start reading a directory we will probably be asked for soon. The I/O
+ * only runs when nothing else needs it. Each client cancels only its own
+ * prefetches, and the result stays loaded while the client holds a
+ * reference on the directory.
+ */
+void               nautilus_directory_prefetch                 (NautilusDirectory         *directory,
+								gconstpointer              client);
+void               nautilus_directory_cancel_prefetch          (NautilusDirectory         *directory,
+								gconstpointer              client);
+
 /* Get a list of all files currently known in the directory. */
 GList *            nautilus_directory_get_file_list            (NautilusDirectory         *directory);
 
@@ -141,6 +141,40 @@ nautilus_file_changes_queue_file_moved (GFile *from,
 	nautilus_file_changes_queue_add_common (queue, new_item);
 }
 
+/* Queues the moves of @from to @to, taking the queue lock only once */
+void
+nautilus_file_changes_queue_files_moved (GList *from,
+					 GList *to)
+{
+	NautilusFileChange *new_item;
+	NautilusFileChangesQueue *queue;
+	GList *items, *f, *t;
+
+	queue = nautilus_file_changes_queue_get ();
+
+	items = NULL;
+	for (f = from, t = to; f != NULL && t != NULL; f = f->next, t = t->next) {
+		new_item = g_new (NautilusFileChange, 1);
+		new_item->kind = CHANGE_FILE_MOVED;
+		new_item->from = g_object_ref (f->data);
+		new_item->to = g_object_ref (t->data);
+		items = g_list_prepend (items, new_item);
+	}
+
+	if (items == NULL) {
+		return;
+	}
+
+	g_mutex_lock (&queue->mutex);
+
+	if (queue->tail == NULL) {
+		queue->tail = g_list_last (items);
+	}
+	queue->head = g_list_concat (items, queue->head);
+
+	g_mutex_unlock (&queue->mutex);
+}
+
 void
 nautilus_file_changes_queue_schedule_position_set (GFile *location, 
 						   GdkPoint point,
@@ -28,6 +28,8 @@ void nautilus_file_changes_queue_file_changed                    (GFile      *lo
 void nautilus_file_changes_queue_file_removed                    (GFile      *location);
 void nautilus_file_changes_queue_file_moved                      (GFile      *from,
 								  GFile      *to);
+void nautilus_file_changes_queue_files_moved                     (GList      *from,
+								  GList      *to);
 void nautilus_file_changes_queue_schedule_position_set           (GFile      *location,
 								  GdkPoint    point,
 								  int         screen);
@@ -31,14 +31,26 @@
 #include <math.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <stdlib.h>
 
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
 #include "nautilus-file-operations.h"
 
 #include "nautilus-file-changes-queue.h"
 #include "nautilus-lib-self-check-functions.h"
 
 #include "nautilus-progress-info.h"
+#include "nautilus-progress-info-manager.h"
 
 #include <eel/eel-glib-extensions.h>
 #include <eel/eel-gtk-extensions.h>
@@ -60,6 +72,7 @@
 #include "nautilus-file-conflict-dialog.h"
 #include "nautilus-file-undo-operations.h"
 #include "nautilus-file-undo-manager.h"
+#include "nautilus-native-dir.h"
 
 /* TODO: TESTING!!! */
 
@@ -71,7 +84,6 @@ typedef struct {
 	NautilusProgressInfo *progress;
 	GCancellable *cancellable;
 	GHashTable *skip_files;
-	GHashTable *skip_readdir_error;
 	NautilusFileUndoInfo *undo_info;
 	gboolean skip_all_error;
 	gboolean skip_all_conflict;
@@ -154,11 +166,15 @@ typedef enum {
 	OP_KIND_TRASH
 } OpKind;
 
+typedef struct _SourceScanner SourceScanner;
+
 typedef struct {
 	int num_files;
 	goffset num_bytes;
-	int num_files_since_progress;
 	OpKind op;
+	SourceScanner *scanner;
+	gboolean scanning;
+	gboolean size_verified;
 } SourceInfo;
 
 typedef struct {
@@ -209,6 +225,12 @@ static void scan_sources (GList *files,
 			  SourceInfo *source_info,
 			  CommonJob *job,
 			  OpKind kind);
+static void source_info_update (SourceInfo *source_info);
+static void stop_scanning_sources (SourceInfo *source_info);
+static void finish_scanning_sources (SourceInfo *source_info,
+				     TransferInfo *transfer_info);
+static void report_preparing_count_progress (CommonJob *job,
+					     SourceInfo *source_info);
 
 
 static void empty_trash_thread_func (GTask *task,
@@ -967,9 +989,6 @@ finalize_common (CommonJob *common)
 	if (common->skip_files) {
 		g_hash_table_destroy (common->skip_files);
 	}
-	if (common->skip_readdir_error) {
-		g_hash_table_destroy (common->skip_readdir_error);
-	}
 
 	if (common->undo_info != NULL) {
 		nautilus_file_undo_manager_set_action (common->undo_info);
@@ -993,18 +1012,6 @@ skip_file (CommonJob *common,
 	g_hash_table_insert (common->skip_files, g_object_ref (file), file);
 }
 
-static void
-skip_readdir_error (CommonJob *common,
-		    GFile *dir)
-{
-	if (common->skip_readdir_error == NULL) {
-		common->skip_readdir_error =
-			g_hash_table_new_full (g_file_hash, (GEqualFunc)g_file_equal, g_object_unref, NULL);
-	}
-
-	g_hash_table_insert (common->skip_readdir_error, g_object_ref (dir), dir);
-}
-
 static gboolean
 should_skip_file (CommonJob *common,
 		  GFile *file)
@@ -1015,16 +1022,6 @@ should_skip_file (CommonJob *common,
 	return FALSE;
 }
 
-static gboolean
-should_skip_readdir_error (CommonJob *common,
-			   GFile *dir)
-{
-	if (common->skip_readdir_error != NULL) {
-		return g_hash_table_lookup (common->skip_readdir_error, dir) != NULL;
-	}
-	return FALSE;
-}
-
 static gboolean
 can_delete_without_confirm (GFile *file)
 {
@@ -1470,6 +1467,30 @@ confirm_delete_directly (CommonJob *job,
 	return response == 1;
 }
 
+/* When the operation caught up with the estimate while it is still being
+ * counted it is not done yet, so this reports that instead of letting the
+ * caller claim completion. Returns TRUE if it handled the report.
+ */
+static gboolean
+report_still_counting (CommonJob *job,
+		       SourceInfo *source_info,
+		       TransferInfo *transfer_info,
+		       int files_left,
+		       guint64 now)
+{
+	if (files_left > 0 || !source_info->scanning) {
+		return FALSE;
+	}
+
+	if (transfer_info->last_report_time == 0 ||
+	    ABS ((gint64)(transfer_info->last_report_time - now)) >= 100 * NSEC_PER_MICROSEC) {
+		transfer_info->last_report_time = now;
+		report_preparing_count_progress (job, source_info);
+	}
+
+	return TRUE;
+}
+
 static void
 report_delete_progress (CommonJob *job,
 			SourceInfo *source_info,
@@ -1484,6 +1505,7 @@ report_delete_progress (CommonJob *job,
         DeleteJob *delete_job;
 
         delete_job = (DeleteJob *) job;
+	source_info_update (source_info);
 	now = g_get_monotonic_time ();
 	files_left = source_info->num_files - transfer_info->num_files;
 
@@ -1492,6 +1514,10 @@ report_delete_progress (CommonJob *job,
 		files_left = 0;
 	}
 
+	if (report_still_counting (job, source_info, transfer_info, files_left, now)) {
+		return;
+	}
+
         /* If the number of files left is 0, we want to update the status without
          * considering this time, since we want to change the status to completed
          * and probably we won't get more calls to this function */
@@ -1503,6 +1529,20 @@ report_delete_progress (CommonJob *job,
 
 	transfer_info->last_report_time = now;
 
+	elapsed = g_timer_elapsed (job->time, NULL);
+        transfer_rate = 0;
+        remaining_time = INT_MAX;
+	if (elapsed > 0) {
+		transfer_rate = transfer_info->num_files / elapsed;
+                if (transfer_rate > 0)
+		        remaining_time = (source_info->num_files - transfer_info->num_files) / transfer_rate;
+	}
+
+	/* Only keep the numbers up to date while nobody shows the text */
+	if (files_left > 0 && !nautilus_progress_manager_has_viewers_any_thread ()) {
+		goto update_numbers;
+	}
+
         if (source_info->num_files == 1) {
                 if (files_left == 0) {
                         status = _("Deleted “%B”");
@@ -1528,15 +1568,6 @@ report_delete_progress (CommonJob *job,
                                                        source_info->num_files));
         }
 
-	elapsed = g_timer_elapsed (job->time, NULL);
-        transfer_rate = 0;
-        remaining_time = INT_MAX;
-	if (elapsed > 0) {
-		transfer_rate = transfer_info->num_files / elapsed;
-                if (transfer_rate > 0)
-		        remaining_time = (source_info->num_files - transfer_info->num_files) / transfer_rate;
-	}
-
 	if (elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE) {
                 if (files_left > 0) {
                         /* To translators: %'d is the number of files completed for the operation,
@@ -1587,6 +1618,7 @@ report_delete_progress (CommonJob *job,
 	}
 	nautilus_progress_info_set_details (job->progress, details);
 
+ update_numbers:
         if (elapsed > SECONDS_NEEDED_FOR_APROXIMATE_TRANSFER_RATE) {
                 nautilus_progress_info_set_remaining_time (job->progress,
                                                            remaining_time);
@@ -1599,12 +1631,333 @@ report_delete_progress (CommonJob *job,
 	}
 }
 
+/* Enumerates the children of a folder for the recursive operations.
+ * Local folders are read through NautilusNativeDir, which doesn't build
+ * a GFileInfo per child, everything else through a GFileEnumerator.
+ */
+typedef struct {
+	GFile *dir;
+	NautilusNativeDir *native;
+	GFileEnumerator *enumerator;
+} ChildEnumerator;
+
+static gboolean
+child_enumerator_open (ChildEnumerator *children,
+		       GFile *dir,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	memset (children, 0, sizeof (ChildEnumerator));
+	children->dir = dir;
+
+	if (g_file_is_native (dir)) {
+		/* On failure let GIO report the error, so the error
+		 * dialogs stay the same. */
+		children->native = nautilus_native_dir_open (dir, NULL);
+		if (children->native != NULL) {
+			return TRUE;
+		}
+	}
+
+	children->enumerator = g_file_enumerate_children (dir,
+							  G_FILE_ATTRIBUTE_STANDARD_NAME,
+							  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+							  cancellable,
+							  error);
+	return children->enumerator != NULL;
+}
+
+static GFile *
+child_enumerator_next (ChildEnumerator *children,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	const NautilusNativeDirEntry *entry;
+	GFileInfo *info;
+	GFile *child;
+
+	if (children->native != NULL) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			return NULL;
+		}
+
+		entry = nautilus_native_dir_next (children->native, error);
+		if (entry == NULL) {
+			return NULL;
+		}
+
+		return g_file_get_child (children->dir, entry->name);
+	}
+
+	info = g_file_enumerator_next_file (children->enumerator, cancellable, error);
+	if (info == NULL) {
+		return NULL;
+	}
+
+	child = g_file_get_child (children->dir, g_file_info_get_name (info));
+	g_object_unref (info);
+
+	return child;
+}
+
+static void
+child_enumerator_close (ChildEnumerator *children,
+			GCancellable *cancellable)
+{
+	if (children->native != NULL) {
+		nautilus_native_dir_close (children->native);
+	} else if (children->enumerator != NULL) {
+		g_file_enumerator_close (children->enumerator, cancellable, NULL);
+		g_object_unref (children->enumerator);
+	}
+
+	memset (children, 0, sizeof (ChildEnumerator));
+}
+
 static void delete_file (CommonJob *job, GFile *file,
 			 gboolean *skipped_file,
 			 SourceInfo *source_info,
 			 TransferInfo *transfer_info,
 			 gboolean toplevel);
 
+/* Fast path for deleting the contents of a local folder. Every folder is
+ * read on a thread pool, its entries are removed relative to the folder
+ * fd, and subfolders are pushed back to the pool and removed
+ * bottom-up once everything below them is gone. Whatever can't be removed
+ * is left in place; delete_dir() then goes over the leftovers with the
+ * regular code, which takes care of the error dialogs.
+ *
+ * Subfolders are opened and removed relative to their parent's fd, which
+ * stays open until they are gone, so nothing is resolved by path again.
+ * The deepest folders are read first, which keeps the number of folders
+ * held open down to a few per level of the tree.
+ */
+#define DELETE_MAX_THREADS 8
+
+typedef struct _NativeDeleteDir NativeDeleteDir;
+
+typedef struct {
+	CommonJob *job;
+	GThreadPool *pool;
+	dev_t device;
+	volatile gint num_deleted;
+
+	GMutex mutex;
+	GCond cond;
+	/* Paths of everything removed since the last flush */
+	GList *removed;
+	gboolean done;
+} NativeDeleteData;
+
+struct _NativeDeleteDir {
+	NativeDeleteData *data;
+	NativeDeleteDir *parent;
+	NautilusNativeDir *native;
+	/* The name in the parent folder, NULL for the toplevel one */
+	char *name;
+	int depth;
+	volatile gint pending;
+	volatile gint failed;
+};
+
+static NativeDeleteDir *
+native_delete_dir_new (NativeDeleteData *data,
+		       NativeDeleteDir *parent,
+		       char *name)
+{
+	NativeDeleteDir *dir;
+
+	dir = g_new0 (NativeDeleteDir, 1);
+	dir->data = data;
+	dir->parent = parent;
+	dir->name = name;
+	dir->depth = parent != NULL ? parent->depth + 1 : 0;
+	/* One for reading the folder itself */
+	dir->pending = 1;
+
+	return dir;
+}
+
+static gint
+native_delete_dir_compare_depth (gconstpointer a,
+				 gconstpointer b,
+				 gpointer user_data)
+{
+	return ((const NativeDeleteDir *) b)->depth - ((const NativeDeleteDir *) a)->depth;
+}
+
+static void
+native_delete_removed (NativeDeleteData *data,
+		       NautilusNativeDir *parent,
+		       const char *name)
+{
+	char *path;
+
+	g_atomic_int_inc (&data->num_deleted);
+
+	path = nautilus_native_dir_get_child_path (parent, name);
+	g_mutex_lock (&data->mutex);
+	data->removed = g_list_prepend (data->removed, path);
+	g_mutex_unlock (&data->mutex);
+}
+
+static void
+native_delete_dir_finish (NativeDeleteDir *dir)
+{
+	NativeDeleteData *data;
+	NativeDeleteDir *parent;
+
+	data = dir->data;
+
+	while (dir != NULL && g_atomic_int_dec_and_test (&dir->pending)) {
+		parent = dir->parent;
+
+		nautilus_native_dir_close (dir->native);
+
+		if (parent == NULL) {
+			/* The toplevel folder itself is removed by delete_dir () */
+			g_mutex_lock (&data->mutex);
+			data->done = TRUE;
+			g_cond_signal (&data->cond);
+			g_mutex_unlock (&data->mutex);
+		} else if (!g_atomic_int_get (&dir->failed) &&
+			   nautilus_native_dir_unlink (parent->native, dir->name, TRUE, NULL)) {
+			native_delete_removed (data, parent->native, dir->name);
+		} else {
+			g_atomic_int_set (&parent->failed, TRUE);
+		}
+
+		g_free (dir->name);
+		g_free (dir);
+		dir = parent;
+	}
+}
+
+static void
+native_delete_thread_func (gpointer task_data,
+			   gpointer user_data)
+{
+	NativeDeleteData *data = user_data;
+	NativeDeleteDir *dir = task_data;
+	NativeDeleteDir *child;
+	const NautilusNativeDirEntry *entry;
+
+	if (g_cancellable_is_cancelled (data->job->cancellable)) {
+		goto failed;
+	}
+
+	/* The toplevel folder comes opened already */
+	if (dir->native == NULL) {
+		dir->native = nautilus_native_dir_open_child (dir->parent->native, dir->name, NULL);
+		if (dir->native == NULL) {
+			goto failed;
+		}
+	}
+
+	/* Don't descend into other filesystems mounted below the folder */
+	if (nautilus_native_dir_get_device (dir->native) != data->device) {
+		goto failed;
+	}
+
+	while ((entry = nautilus_native_dir_next (dir->native, NULL)) != NULL) {
+		if (g_cancellable_is_cancelled (data->job->cancellable)) {
+			g_atomic_int_set (&dir->failed, TRUE);
+			break;
+		}
+
+		if (nautilus_native_dir_entry_is_dir (dir->native, entry)) {
+			child = native_delete_dir_new (data, dir, g_strdup (entry->name));
+			g_atomic_int_inc (&dir->pending);
+			g_thread_pool_push (data->pool, child, NULL);
+		} else if (nautilus_native_dir_unlink (dir->native, entry->name, FALSE, NULL)) {
+			native_delete_removed (data, dir->native, entry->name);
+		} else {
+			g_atomic_int_set (&dir->failed, TRUE);
+		}
+	}
+
+	native_delete_dir_finish (dir);
+	return;
+
+ failed:
+	g_atomic_int_set (&dir->failed, TRUE);
+	native_delete_dir_finish (dir);
+}
+
+static void
+flush_native_removed (NativeDeleteData *data)
+{
+	GList *removed, *l;
+	GFile *file;
+
+	g_mutex_lock (&data->mutex);
+	removed = data->removed;
+	data->removed = NULL;
+	g_mutex_unlock (&data->mutex);
+
+	for (l = removed; l != NULL; l = l->next) {
+		file = g_file_new_for_path (l->data);
+		nautilus_file_changes_queue_file_removed (file);
+		g_object_unref (file);
+	}
+
+	g_list_free_full (removed, g_free);
+}
+
+static void
+delete_native_dir_contents (CommonJob *job,
+			    GFile *dir,
+			    SourceInfo *source_info,
+			    TransferInfo *transfer_info)
+{
+	NativeDeleteData data;
+	NativeDeleteDir *toplevel;
+	NautilusNativeDir *native;
+	int num_files;
+
+	native = nautilus_native_dir_open (dir, NULL);
+	if (native == NULL) {
+		return;
+	}
+
+	memset (&data, 0, sizeof (data));
+	data.job = job;
+	data.device = nautilus_native_dir_get_device (native);
+	g_mutex_init (&data.mutex);
+	g_cond_init (&data.cond);
+	data.pool = g_thread_pool_new (native_delete_thread_func, &data,
+				       MIN (g_get_num_processors (), DELETE_MAX_THREADS),
+				       FALSE, NULL);
+	g_thread_pool_set_sort_function (data.pool, native_delete_dir_compare_depth, NULL);
+
+	num_files = transfer_info->num_files;
+	toplevel = native_delete_dir_new (&data, NULL, NULL);
+	toplevel->native = native;
+	g_thread_pool_push (data.pool, toplevel, NULL);
+
+	/* Batch the progress updates instead of reporting every file */
+	g_mutex_lock (&data.mutex);
+	while (!data.done) {
+		g_cond_wait_until (&data.cond, &data.mutex,
+				   g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND);
+		g_mutex_unlock (&data.mutex);
+
+		flush_native_removed (&data);
+		transfer_info->num_files = num_files + g_atomic_int_get (&data.num_deleted);
+		report_delete_progress (job, source_info, transfer_info);
+		g_mutex_lock (&data.mutex);
+	}
+	g_mutex_unlock (&data.mutex);
+
+	g_thread_pool_free (data.pool, FALSE, TRUE);
+
+	flush_native_removed (&data);
+	transfer_info->num_files = num_files + g_atomic_int_get (&data.num_deleted);
+
+	g_mutex_clear (&data.mutex);
+	g_cond_clear (&data.cond);
+}
+
 static void
 delete_dir (CommonJob *job, GFile *dir,
 	    gboolean *skipped_file,
@@ -1612,38 +1965,30 @@ delete_dir (CommonJob *job, GFile *dir,
 	    TransferInfo *transfer_info,
 	    gboolean toplevel)
 {
-	GFileInfo *info;
 	GError *error;
 	GFile *file;
-	GFileEnumerator *enumerator;
+	ChildEnumerator children;
 	char *primary, *secondary, *details;
 	int response;
-	gboolean skip_error;
 	gboolean local_skipped_file;
 
 	local_skipped_file = FALSE;
-	
-	skip_error = should_skip_readdir_error (job, dir);
+
+	if (toplevel && g_file_is_native (dir)) {
+		delete_native_dir_contents (job, dir, source_info, transfer_info);
+	}
+
  retry:
 	error = NULL;
-	enumerator = g_file_enumerate_children (dir,
-						G_FILE_ATTRIBUTE_STANDARD_NAME,
-						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-						job->cancellable,
-						&error);
-	if (enumerator) {
+	if (child_enumerator_open (&children, dir, job->cancellable, &error)) {
 		error = NULL;
 		
 		while (!job_aborted (job) &&
-		       (info = g_file_enumerator_next_file (enumerator, job->cancellable, skip_error?NULL:&error)) != NULL) {
-			file = g_file_get_child (dir,
-						 g_file_info_get_name (info));
+		       (file = child_enumerator_next (&children, job->cancellable, &error)) != NULL) {
 			delete_file (job, file, &local_skipped_file, source_info, transfer_info, FALSE);
 			g_object_unref (file);
-			g_object_unref (info);
 		}
-		g_file_enumerator_close (enumerator, job->cancellable, NULL);
-		g_object_unref (enumerator);
+		child_enumerator_close (&children, job->cancellable);
 		
 		if (error && IS_IO_ERROR (error, CANCELLED)) {
 			g_error_free (error);
@@ -1842,6 +2187,7 @@ delete_files (CommonJob *job, GList *files, int *files_skipped)
 		      job,
 		      OP_KIND_DELETE);
 	if (job_aborted (job)) {
+		stop_scanning_sources (&source_info);
 		return;
 	}
 
@@ -1864,6 +2210,13 @@ delete_files (CommonJob *job, GList *files, int *files_skipped)
 			(*files_skipped)++;
 		}
 	}
+
+	if (!job_aborted (job)) {
+		finish_scanning_sources (&source_info, &transfer_info);
+		report_delete_progress (job, &source_info, &transfer_info);
+	}
+
+	stop_scanning_sources (&source_info);
 }
 
 static void
@@ -1880,6 +2233,7 @@ report_trash_progress (CommonJob    *job,
         DeleteJob *delete_job;
 
         delete_job = (DeleteJob *) job;
+	source_info_update (source_info);
 	now = g_get_monotonic_time ();
 	files_left = source_info->num_files - transfer_info->num_files;
 
@@ -1888,6 +2242,10 @@ report_trash_progress (CommonJob    *job,
 		files_left = 0;
 	}
 
+	if (report_still_counting (job, source_info, transfer_info, files_left, now)) {
+		return;
+	}
+
         /* If the number of files left is 0, we want to update the status without
          * considering this time, since we want to change the status to completed
          * and probably we won't get more calls to this function */
@@ -1899,6 +2257,20 @@ report_trash_progress (CommonJob    *job,
 
 	transfer_info->last_report_time = now;
 
+	elapsed = g_timer_elapsed (job->time, NULL);
+        transfer_rate = 0;
+        remaining_time = INT_MAX;
+	if (elapsed > 0) {
+		transfer_rate = transfer_info->num_files / elapsed;
+                if (transfer_rate > 0)
+		        remaining_time = (source_info->num_files - transfer_info->num_files) / transfer_rate;
+	}
+
+	/* Only keep the numbers up to date while nobody shows the text */
+	if (files_left > 0 && !nautilus_progress_manager_has_viewers_any_thread ()) {
+		goto update_numbers;
+	}
+
         if (source_info->num_files == 1) {
                 if (files_left > 0) {
                         status = _("Trashing “%B”");
@@ -1924,16 +2296,6 @@ report_trash_progress (CommonJob    *job,
                                                        source_info->num_files));
         }
 
-
-	elapsed = g_timer_elapsed (job->time, NULL);
-        transfer_rate = 0;
-        remaining_time = INT_MAX;
-	if (elapsed > 0) {
-		transfer_rate = transfer_info->num_files / elapsed;
-                if (transfer_rate > 0)
-		        remaining_time = (source_info->num_files - transfer_info->num_files) / transfer_rate;
-	}
-
 	if (elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE) {
                 if (files_left > 0) {
                         /* To translators: %'d is the number of files completed for the operation,
@@ -1983,6 +2345,7 @@ report_trash_progress (CommonJob    *job,
 	}
 	nautilus_progress_info_set_details (job->progress, details);
 
+ update_numbers:
         if (elapsed > SECONDS_NEEDED_FOR_APROXIMATE_TRANSFER_RATE) {
                 nautilus_progress_info_set_remaining_time (job->progress,
                                                            remaining_time);
@@ -1995,46 +2358,38 @@ report_trash_progress (CommonJob    *job,
 	}
 }
 
+/* @error is the result of trashing @file, NULL if it succeeded */
 static void
 trash_file (CommonJob    *job,
             GFile        *file,
+            GError       *error,
             gboolean     *skipped_file,
             SourceInfo   *source_info,
             TransferInfo *transfer_info,
             gboolean      toplevel,
             GList       **to_delete)
 {
-	GError *error;
 	char *primary, *secondary, *details;
 	int response;
 
-	if (should_skip_file (job, file)) {
-		*skipped_file = TRUE;
-		return;
-	}
-
-	error = NULL;
-
-	if (g_file_trash (file, job->cancellable, &error)) {
-	        transfer_info->num_files ++;
+	if (error == NULL) {
 		nautilus_file_changes_queue_file_removed (file);
 
 		if (job->undo_info != NULL) {
 			nautilus_file_undo_info_trash_add_file (NAUTILUS_FILE_UNDO_INFO_TRASH (job->undo_info), file);
 		}
 
-		report_trash_progress (job, source_info, transfer_info);
                 return;
 	}
 
 	if (job->skip_all_error) {
 	        *skipped_file = TRUE;
-		goto skip;
+		return;
 	}
 
 	if (job->delete_all) {
 		*to_delete = g_list_prepend (*to_delete, file);
-		goto skip;
+		return;
 	}
 
 	/* Translators: %B is a file name */
@@ -2070,9 +2425,49 @@ trash_file (CommonJob    *job,
 	} else if (response == 4) { /* delete */
 		*to_delete = g_list_prepend (*to_delete, file);
 	}
+}
+
+/* The toplevel items are trashed in parallel on a thread pool. The results
+ * are then handled in order on the job thread, which is where the undo
+ * information is recorded and the error dialogs are shown. No new items
+ * are handed to the pool while a failure waits to be handled, so that
+ * cancelling or skipping in the dialog still stops the rest.
+ */
+#define TRASH_MAX_THREADS 4
+
+typedef struct {
+	GFile *file;
+	GError *error;
+	gboolean skipped;
+	gboolean done;
+} TrashTask;
+
+typedef struct {
+	CommonJob *job;
+	volatile gint num_trashed;
+	volatile gint num_failed;
+	GMutex mutex;
+	GCond cond;
+} TrashData;
+
+static void
+trash_thread_func (gpointer task_data,
+		   gpointer user_data)
+{
+	TrashData *data = user_data;
+	TrashTask *task = task_data;
+
+	if (!g_cancellable_set_error_if_cancelled (data->job->cancellable, &task->error) &&
+	    g_file_trash (task->file, data->job->cancellable, &task->error)) {
+		g_atomic_int_inc (&data->num_trashed);
+	} else {
+		g_atomic_int_inc (&data->num_failed);
+	}
 
-skip:
-	g_error_free (error);
+	g_mutex_lock (&data->mutex);
+	task->done = TRUE;
+	g_cond_signal (&data->cond);
+	g_mutex_unlock (&data->mutex);
 }
 
 static void
@@ -2081,11 +2476,14 @@ trash_files (CommonJob *job,
              int       *files_skipped)
 {
 	GList *l;
-	GFile *file;
 	GList *to_delete;
+	GThreadPool *pool;
+	TrashTask *tasks, *task;
+	TrashData data;
 	SourceInfo source_info;
 	TransferInfo transfer_info;
-        gboolean skipped_file;
+	gboolean skipped_file;
+	int n_tasks, n_pushed, n_handled;
 
 	if (job_aborted (job)) {
 		return;
@@ -2096,6 +2494,7 @@ trash_files (CommonJob *job,
 		      job,
 		      OP_KIND_TRASH);
 	if (job_aborted (job)) {
+		stop_scanning_sources (&source_info);
 		return;
 	}
 
@@ -2104,22 +2503,93 @@ trash_files (CommonJob *job,
 	memset (&transfer_info, 0, sizeof (transfer_info));
 	report_trash_progress (job, &source_info, &transfer_info);
 
-	to_delete = NULL;
-	for (l = files;
-	     l != NULL && !job_aborted (job);
-	     l = l->next) {
-		file = l->data;
+	n_tasks = g_list_length (files);
+	tasks = g_new0 (TrashTask, n_tasks);
+	for (l = files, n_pushed = 0; l != NULL; l = l->next, n_pushed++) {
+		tasks[n_pushed].file = l->data;
+	}
 
-		skipped_file = FALSE;
-                trash_file (job, file,
-                            &skipped_file,
-                            &source_info, &transfer_info,
-                            TRUE, &to_delete);
+	memset (&data, 0, sizeof (data));
+	data.job = job;
+	g_mutex_init (&data.mutex);
+	g_cond_init (&data.cond);
+	pool = g_thread_pool_new (trash_thread_func, &data,
+				  MIN (n_tasks, TRASH_MAX_THREADS),
+				  FALSE, NULL);
+
+	to_delete = NULL;
+	n_pushed = 0;
+	n_handled = 0;
+	while (n_handled < n_pushed ||
+	       (n_pushed < n_tasks && !job_aborted (job))) {
+		/* Keep the pool busy, unless a failure needs an answer first */
+		while (n_pushed < n_tasks &&
+		       n_pushed - n_handled < TRASH_MAX_THREADS &&
+		       g_atomic_int_get (&data.num_failed) == 0 &&
+		       !job_aborted (job)) {
+			task = &tasks[n_pushed++];
+
+			if (should_skip_file (job, task->file)) {
+				task->skipped = TRUE;
+				task->done = TRUE;
+			} else {
+				g_thread_pool_push (pool, task, NULL);
+			}
+		}
+
+		if (n_handled == n_pushed) {
+			continue;
+		}
+
+		/* Batch the progress updates while the pool is busy */
+		task = &tasks[n_handled++];
+		g_mutex_lock (&data.mutex);
+		while (!task->done) {
+			g_cond_wait_until (&data.cond, &data.mutex,
+					   g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND);
+			g_mutex_unlock (&data.mutex);
+
+			transfer_info.num_files = g_atomic_int_get (&data.num_trashed);
+			report_trash_progress (job, &source_info, &transfer_info);
+
+			g_mutex_lock (&data.mutex);
+		}
+		g_mutex_unlock (&data.mutex);
+
+		transfer_info.num_files = g_atomic_int_get (&data.num_trashed);
+
+		skipped_file = task->skipped;
+
+		/* Files trashed before an abort still need to be recorded */
+		if (!skipped_file &&
+		    (task->error == NULL || !job_aborted (job))) {
+	                trash_file (job, task->file, task->error,
+	                            &skipped_file,
+	                            &source_info, &transfer_info,
+	                            TRUE, &to_delete);
+		}
 		if (skipped_file) {
 			(*files_skipped)++;
 		}
+
+		if (task->error != NULL) {
+			g_atomic_int_add (&data.num_failed, -1);
+			g_clear_error (&task->error);
+		}
+	}
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_mutex_clear (&data.mutex);
+	g_cond_clear (&data.cond);
+	g_free (tasks);
+
+	if (!job_aborted (job)) {
+		finish_scanning_sources (&source_info, &transfer_info);
+		report_trash_progress (job, &source_info, &transfer_info);
 	}
 
+	stop_scanning_sources (&source_info);
+
 	if (to_delete) {
 		to_delete = g_list_reverse (to_delete);
 		delete_files (job, to_delete, files_skipped);
@@ -2736,20 +3206,6 @@ report_preparing_count_progress (CommonJob *job,
 	nautilus_progress_info_pulse_progress (job->progress);
 }
 
-static void
-count_file (GFileInfo *info,
-	    CommonJob *job,
-	    SourceInfo *source_info)
-{
-	source_info->num_files += 1;
-	source_info->num_bytes += g_file_info_get_size (info);
-
-	if (source_info->num_files_since_progress++ > 100) {
-		report_preparing_count_progress (job, source_info);
-		source_info->num_files_since_progress = 0;
-	}
-}
-
 static char *
 get_scan_primary (OpKind kind)
 {
@@ -2766,128 +3222,256 @@ get_scan_primary (OpKind kind)
 	}
 }
 
+/* The size estimation runs concurrently with the operation itself. The
+ * toplevel items are scanned on the pool and every directory found is
+ * pushed back to it, so the walk fans out over SCAN_MAX_THREADS threads.
+ * The totals only feed the progress reporting, so read errors are ignored
+ * here: the operation reaches the same files and reports them itself.
+ */
+#define SCAN_MAX_THREADS 8
+
+struct _SourceScanner {
+	CommonJob *job;
+	OpKind op;
+	GThreadPool *pool;
+
+	GMutex mutex;
+	int num_files;
+	goffset num_bytes;
+	int pending;
+	gboolean stopping;
+};
+
+/* Local folders below the toplevel items are only known by their name in
+ * their parent, which the task keeps open so they are opened relative to
+ * it. Everything else is known by its GFile. The deepest folders are
+ * scanned first, which keeps few parents open at a time.
+ */
+typedef struct {
+	GFile *file;
+	NautilusNativeDir *parent;
+	char *name;
+	int depth;
+	gboolean toplevel;
+} ScanTask;
+
+static ScanTask *
+scan_task_new (GFile *file,
+	       NautilusNativeDir *parent,
+	       char *name,
+	       int depth,
+	       gboolean toplevel)
+{
+	ScanTask *task;
+
+	task = g_new (ScanTask, 1);
+	task->file = file;
+	task->parent = parent;
+	task->name = name;
+	task->depth = depth;
+	task->toplevel = toplevel;
+
+	return task;
+}
+
 static void
-scan_dir (GFile *dir,
-	  SourceInfo *source_info,
-	  CommonJob *job,
-	  GQueue *dirs)
+scan_task_free (ScanTask *task)
 {
-	GFileInfo *info;
-	GError *error;
-	GFile *subdir;
+	g_clear_object (&task->file);
+	nautilus_native_dir_close (task->parent);
+	g_free (task->name);
+	g_free (task);
+}
+
+static gint
+scan_task_compare_depth (gconstpointer a,
+			 gconstpointer b,
+			 gpointer user_data)
+{
+	return ((const ScanTask *) b)->depth - ((const ScanTask *) a)->depth;
+}
+
+static gboolean
+scanner_should_stop (SourceScanner *scanner)
+{
+	return g_atomic_int_get (&scanner->stopping) ||
+	       g_cancellable_is_cancelled (scanner->job->cancellable);
+}
+
+static void
+scanner_push_locked (SourceScanner *scanner,
+		     ScanTask *task)
+{
+	if (scanner->stopping) {
+		scan_task_free (task);
+		return;
+	}
+
+	scanner->pending++;
+	g_thread_pool_push (scanner->pool, task, NULL);
+}
+
+static void
+scan_native_dir (SourceScanner *scanner,
+		 NautilusNativeDir *dir,
+		 int depth,
+		 int *num_files,
+		 goffset *num_bytes,
+		 GList **subdirs)
+{
+	const NautilusNativeDirEntry *entry;
+	struct stat statbuf;
+
+	while (!scanner_should_stop (scanner) &&
+	       (entry = nautilus_native_dir_next (dir, NULL)) != NULL) {
+		if (!nautilus_native_dir_stat (dir, entry->name, &statbuf, NULL)) {
+			continue;
+		}
+
+		(*num_files)++;
+		*num_bytes += statbuf.st_size;
+
+		if (S_ISDIR (statbuf.st_mode)) {
+			*subdirs = g_list_prepend (*subdirs,
+						   scan_task_new (NULL,
+								  nautilus_native_dir_ref (dir),
+								  g_strdup (entry->name),
+								  depth + 1,
+								  FALSE));
+		}
+	}
+}
+
+static void
+scan_task_thread_func (gpointer data,
+		       gpointer user_data)
+{
+	SourceScanner *scanner = user_data;
+	ScanTask *task = data;
+	NautilusNativeDir *native;
 	GFileEnumerator *enumerator;
-	char *primary, *secondary, *details;
-	int response;
-	SourceInfo saved_info;
+	GFileInfo *info;
+	GList *subdirs, *l;
+	int num_files;
+	goffset num_bytes;
+	gboolean is_dir;
 
-	saved_info = *source_info;
+	subdirs = NULL;
+	num_files = 0;
+	num_bytes = 0;
 
- retry:
-	error = NULL;
-	enumerator = g_file_enumerate_children (dir,
+	if (scanner_should_stop (scanner)) {
+		goto out;
+	}
+
+	if (task->toplevel) {
+		info = g_file_query_info (task->file,
+					  G_FILE_ATTRIBUTE_STANDARD_TYPE","
+					  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					  scanner->job->cancellable,
+					  NULL);
+		if (info == NULL) {
+			goto out;
+		}
+
+		num_files++;
+		num_bytes += g_file_info_get_size (info);
+		is_dir = g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY;
+		g_object_unref (info);
+
+		/* Trashing moves whole folders, only the toplevel items count */
+		if (!is_dir || scanner->op == OP_KIND_TRASH) {
+			goto out;
+		}
+
+	}
+
+	if (task->parent != NULL) {
+		native = nautilus_native_dir_open_child (task->parent, task->name, NULL);
+	} else if (g_file_is_native (task->file)) {
+		native = nautilus_native_dir_open (task->file, NULL);
+	} else {
+		native = NULL;
+	}
+
+	if (native != NULL) {
+		scan_native_dir (scanner, native, task->depth, &num_files, &num_bytes, &subdirs);
+		nautilus_native_dir_close (native);
+		goto out;
+	}
+
+	/* Local folders that can't be opened are skipped, as the operation
+	 * reports them anyway */
+	if (task->parent != NULL || g_file_is_native (task->file)) {
+		goto out;
+	}
+
+	enumerator = g_file_enumerate_children (task->file,
 						G_FILE_ATTRIBUTE_STANDARD_NAME","
 						G_FILE_ATTRIBUTE_STANDARD_TYPE","
 						G_FILE_ATTRIBUTE_STANDARD_SIZE,
 						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-						job->cancellable,
-						&error);
-	if (enumerator) {
-		error = NULL;
-		while ((info = g_file_enumerator_next_file (enumerator, job->cancellable, &error)) != NULL) {
-			count_file (info, job, source_info);
+						scanner->job->cancellable,
+						NULL);
+	if (enumerator == NULL) {
+		goto out;
+	}
 
-			if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
-				subdir = g_file_get_child (dir,
-							   g_file_info_get_name (info));
-				
-				/* Push to head, since we want depth-first */
-				g_queue_push_head (dirs, subdir);
-			}
+	while (!scanner_should_stop (scanner) &&
+	       (info = g_file_enumerator_next_file (enumerator, scanner->job->cancellable, NULL)) != NULL) {
+		num_files++;
+		num_bytes += g_file_info_get_size (info);
 
-			g_object_unref (info);
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			subdirs = g_list_prepend (subdirs,
+						  scan_task_new (g_file_get_child (task->file,
+										   g_file_info_get_name (info)),
+								 NULL, NULL, task->depth + 1, FALSE));
 		}
-		g_file_enumerator_close (enumerator, job->cancellable, NULL);
-		g_object_unref (enumerator);
-		
-		if (error && IS_IO_ERROR (error, CANCELLED)) {
-			g_error_free (error);
-		} else if (error) {
-			primary = get_scan_primary (source_info->op);
-			details = NULL;
-			
-			if (IS_IO_ERROR (error, PERMISSION_DENIED)) {
-				secondary = f (_("Files in the folder “%B” cannot be handled because you do "
-						 "not have permissions to see them."), dir);
-			} else {
-				secondary = f (_("There was an error getting information about the files in the folder “%B”."), dir);
-				details = error->message;
-			}
-			
-			response = run_warning (job,
-						primary,
-						secondary,
-						details,
-						FALSE,
-						CANCEL, RETRY, SKIP,
-						NULL);
 
-			g_error_free (error);
-			
-			if (response == 0 || response == GTK_RESPONSE_DELETE_EVENT) {
-				abort_job (job);
-			} else if (response == 1) {
-				*source_info = saved_info;
-				goto retry;
-			} else if (response == 2) {
-				skip_readdir_error (job, dir);
-			} else {
-				g_assert_not_reached ();
-			}
-		}
-		
-	} else if (job->skip_all_error) {
-		g_error_free (error);
-		skip_file (job, dir);
-	} else if (IS_IO_ERROR (error, CANCELLED)) {
-		g_error_free (error);
-	} else {	
-		primary = get_scan_primary (source_info->op);
-		details = NULL;
-		
-		if (IS_IO_ERROR (error, PERMISSION_DENIED)) {
-			secondary = f (_("The folder “%B” cannot be handled because you do not have "
-					 "permissions to read it."), dir);
-		} else {
-			secondary = f (_("There was an error reading the folder “%B”."), dir);
-			details = error->message;
-		}
-		/* set show_all to TRUE here, as we don't know how many
-		 * files we'll end up processing yet.
-		 */
-		response = run_warning (job,
-					primary,
-					secondary,
-					details,
-					TRUE,
-					CANCEL, SKIP_ALL, SKIP, RETRY,
-					NULL);
-		
-		g_error_free (error);
+		g_object_unref (info);
+	}
+	g_file_enumerator_close (enumerator, scanner->job->cancellable, NULL);
+	g_object_unref (enumerator);
 
-		if (response == 0 || response == GTK_RESPONSE_DELETE_EVENT) {
-			abort_job (job);
-		} else if (response == 1 || response == 2) {
-			if (response == 1) {
-				job->skip_all_error = TRUE;
-			}
-			skip_file (job, dir);
-		} else if (response == 3) {
-			goto retry;
-		} else {
-			g_assert_not_reached ();
-		}
+ out:
+	g_mutex_lock (&scanner->mutex);
+
+	scanner->num_files += num_files;
+	scanner->num_bytes += num_bytes;
+
+	for (l = subdirs; l != NULL; l = l->next) {
+		scanner_push_locked (scanner, l->data);
+	}
+
+	scanner->pending--;
+
+	g_mutex_unlock (&scanner->mutex);
+
+	g_list_free (subdirs);
+	scan_task_free (task);
+}
+
+/* Copies the current estimate into @source_info. Only ever call this
+ * from the job thread that owns @source_info.
+ */
+static void
+source_info_update (SourceInfo *source_info)
+{
+	SourceScanner *scanner;
+
+	scanner = source_info->scanner;
+	if (scanner == NULL) {
+		return;
 	}
-}	
+
+	g_mutex_lock (&scanner->mutex);
+	source_info->num_files = scanner->num_files;
+	source_info->num_bytes = scanner->num_bytes;
+	source_info->scanning = scanner->pending > 0;
+	g_mutex_unlock (&scanner->mutex);
+}
 
 static void
 scan_file (GFile *file,
@@ -2896,31 +3480,25 @@ scan_file (GFile *file,
 {
 	GFileInfo *info;
 	GError *error;
-	GQueue *dirs;
-	GFile *dir;
 	char *primary;
 	char *secondary;
 	char *details;
 	int response;
 
-	dirs = g_queue_new ();
-	
  retry:
 	error = NULL;
 	info = g_file_query_info (file, 
-				  G_FILE_ATTRIBUTE_STANDARD_TYPE","
-				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_ATTRIBUTE_STANDARD_TYPE,
 				  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
 				  job->cancellable,
 				  &error);
 
 	if (info) {
-		count_file (info, job, source_info);
+		g_mutex_lock (&source_info->scanner->mutex);
+		scanner_push_locked (source_info->scanner,
+				     scan_task_new (g_object_ref (file), NULL, NULL, 0, TRUE));
+		g_mutex_unlock (&source_info->scanner->mutex);
 
-		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
-			g_queue_push_head (dirs, g_object_ref (file));
-		}
-		
 		g_object_unref (info);
 	} else if (job->skip_all_error) {
 		g_error_free (error);
@@ -2964,24 +3542,21 @@ scan_file (GFile *file,
 			g_assert_not_reached ();
 		}
 	}
-		
-	while (!job_aborted (job) && 
-	       (dir = g_queue_pop_head (dirs)) != NULL) {
-		scan_dir (dir, source_info, job, dirs);
-		g_object_unref (dir);
-	}
-
-	/* Free all from queue if we exited early */
-	g_queue_foreach (dirs, (GFunc)g_object_unref, NULL);
-	g_queue_free (dirs);
 }
 
+/* Checks the toplevel items synchronously, so unreadable ones can be
+ * skipped up front as before, and starts counting their contents in the
+ * background. The operation should start right away and pick up the
+ * refined estimate through source_info_update(). Every call must be
+ * paired with stop_scanning_sources() before @source_info goes away.
+ */
 static void
 scan_sources (GList *files,
 	      SourceInfo *source_info,
 	      CommonJob *job,
 	      OpKind kind)
 {
+	SourceScanner *scanner;
 	GList *l;
 	GFile *file;
 
@@ -2989,7 +3564,17 @@ scan_sources (GList *files,
 	source_info->op = kind;
 
 	report_preparing_count_progress (job, source_info);
-	
+
+	scanner = g_new0 (SourceScanner, 1);
+	scanner->job = job;
+	scanner->op = kind;
+	g_mutex_init (&scanner->mutex);
+	scanner->pool = g_thread_pool_new (scan_task_thread_func, scanner,
+					   MIN (g_get_num_processors (), SCAN_MAX_THREADS),
+					   FALSE, NULL);
+	g_thread_pool_set_sort_function (scanner->pool, scan_task_compare_depth, NULL);
+	source_info->scanner = scanner;
+
 	for (l = files; l != NULL && !job_aborted (job); l = l->next) {
 		file = l->data;
 
@@ -2998,8 +3583,48 @@ scan_sources (GList *files,
 			   job);
 	}
 
-	/* Make sure we report the final count */
-	report_preparing_count_progress (job, source_info);
+	source_info_update (source_info);
+}
+
+static void
+stop_scanning_sources (SourceInfo *source_info)
+{
+	SourceScanner *scanner;
+
+	scanner = source_info->scanner;
+	if (scanner == NULL) {
+		return;
+	}
+
+	/* Workers only push new directories while holding the lock and
+	 * not stopping, so nothing gets pushed once the pool is freed. The
+	 * tasks still queued bail out right away and just free themselves. */
+	g_mutex_lock (&scanner->mutex);
+	g_atomic_int_set (&scanner->stopping, TRUE);
+	g_mutex_unlock (&scanner->mutex);
+
+	g_thread_pool_free (scanner->pool, FALSE, TRUE);
+
+	source_info->scanner = NULL;
+	source_info->scanning = FALSE;
+
+	g_mutex_clear (&scanner->mutex);
+	g_free (scanner);
+}
+
+/* Like stop_scanning_sources(), for an operation that got through all
+ * of its files: whatever the scan had not counted yet was handled all
+ * the same, so the final report uses the transferred totals if larger.
+ */
+static void
+finish_scanning_sources (SourceInfo *source_info,
+			 TransferInfo *transfer_info)
+{
+	source_info_update (source_info);
+	stop_scanning_sources (source_info);
+
+	source_info->num_files = MAX (source_info->num_files, transfer_info->num_files);
+	source_info->num_bytes = MAX (source_info->num_bytes, transfer_info->num_bytes);
 }
 
 static void
@@ -3173,6 +3798,38 @@ verify_destination (CommonJob *job,
 	g_object_unref (fsinfo);
 }
 
+/* The total size is only known once the background scan is done, so the
+ * free space part of verify_destination() runs then. Asking about the
+ * destination once data got written there is too late, so past that
+ * point running out of space is left to the copy itself.
+ */
+static void
+verify_scanned_destination_size (CommonJob *job,
+				 GFile *dest_dir,
+				 SourceInfo *source_info,
+				 TransferInfo *transfer_info)
+{
+	if (source_info->size_verified) {
+		return;
+	}
+
+	if (transfer_info->num_bytes > 0) {
+		source_info->size_verified = TRUE;
+		return;
+	}
+
+	source_info_update (source_info);
+	if (source_info->scanning) {
+		return;
+	}
+
+	source_info->size_verified = TRUE;
+	verify_destination (job,
+			    dest_dir,
+			    NULL,
+			    source_info->num_bytes);
+}
+
 static void
 report_copy_progress (CopyMoveJob *copy_job,
 		      SourceInfo *source_info,
@@ -3191,7 +3848,8 @@ report_copy_progress (CopyMoveJob *copy_job,
 	job = (CommonJob *)copy_job;
 
 	is_move = copy_job->is_move;
-	
+
+	source_info_update (source_info);
 	now = g_get_monotonic_time ();
 
 	files_left = source_info->num_files - transfer_info->num_files;
@@ -3201,6 +3859,10 @@ report_copy_progress (CopyMoveJob *copy_job,
 		files_left = 0;
 	}
 
+	if (report_still_counting (job, source_info, transfer_info, files_left, now)) {
+		return;
+	}
+
         /* If the number of files left is 0, we want to update the status without
          * considering this time, since we want to change the status to completed
          * and probably we won't get more calls to this function */
@@ -3211,6 +3873,22 @@ report_copy_progress (CopyMoveJob *copy_job,
 	}
 	transfer_info->last_report_time = now;
 
+	total_size = MAX (source_info->num_bytes, transfer_info->num_bytes);
+	
+	elapsed = g_timer_elapsed (job->time, NULL);
+	transfer_rate = 0;
+        remaining_time = INT_MAX;
+	if (elapsed > 0) {
+		transfer_rate = transfer_info->num_bytes / elapsed;
+                if (transfer_rate > 0)
+		        remaining_time = (total_size - transfer_info->num_bytes) / transfer_rate;
+	}
+
+	/* Only keep the numbers up to date while nobody shows the text */
+	if (files_left > 0 && !nautilus_progress_manager_has_viewers_any_thread ()) {
+		goto update_numbers;
+	}
+
 	if (files_left != transfer_info->last_reported_files_left ||
 	    transfer_info->last_reported_files_left == 0) {
 		/* Avoid changing this unless files_left changed since last time */
@@ -3303,17 +3981,6 @@ report_copy_progress (CopyMoveJob *copy_job,
 			}
 		}
 	}
-	
-	total_size = MAX (source_info->num_bytes, transfer_info->num_bytes);
-	
-	elapsed = g_timer_elapsed (job->time, NULL);
-	transfer_rate = 0;
-        remaining_time = INT_MAX;
-	if (elapsed > 0) {
-		transfer_rate = transfer_info->num_bytes / elapsed;
-                if (transfer_rate > 0)
-		        remaining_time = (total_size - transfer_info->num_bytes) / transfer_rate;
-	}
 
   	if (elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE &&
             transfer_rate > 0) {
@@ -3379,6 +4046,7 @@ report_copy_progress (CopyMoveJob *copy_job,
 	}
 	nautilus_progress_info_take_details (job->progress, details);
 
+ update_numbers:
         if (elapsed > SECONDS_NEEDED_FOR_APROXIMATE_TRANSFER_RATE) {
                 nautilus_progress_info_set_remaining_time (job->progress,
                                                            remaining_time);
@@ -3932,14 +4600,12 @@ copy_move_directory (CopyMoveJob *copy_job,
 		     gboolean *skipped_file,
 		     gboolean readonly_source_fs)
 {
-	GFileInfo *info;
 	GError *error;
 	GFile *src_file;
-	GFileEnumerator *enumerator;
+	ChildEnumerator children;
 	char *primary, *secondary, *details;
 	char *dest_fs_type;
 	int response;
-	gboolean skip_error;
 	gboolean local_skipped_file;
 	CommonJob *job;
 	GFileCopyFlags flags;
@@ -3973,29 +4639,19 @@ copy_move_directory (CopyMoveJob *copy_job,
 	local_skipped_file = FALSE;
 	dest_fs_type = NULL;
 	
-	skip_error = should_skip_readdir_error (job, src);
  retry:
 	error = NULL;
-	enumerator = g_file_enumerate_children (src,
-						G_FILE_ATTRIBUTE_STANDARD_NAME,
-						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-						job->cancellable,
-						&error);
-	if (enumerator) {
+	if (child_enumerator_open (&children, src, job->cancellable, &error)) {
 		error = NULL;
 
 		while (!job_aborted (job) &&
-		       (info = g_file_enumerator_next_file (enumerator, job->cancellable, skip_error?NULL:&error)) != NULL) {
-			src_file = g_file_get_child (src,
-						     g_file_info_get_name (info));
+		       (src_file = child_enumerator_next (&children, job->cancellable, &error)) != NULL) {
 			copy_move_file (copy_job, src_file, *dest, same_fs, FALSE, &dest_fs_type,
 					source_info, transfer_info, NULL, NULL, FALSE, &local_skipped_file,
 					readonly_source_fs);
 			g_object_unref (src_file);
-			g_object_unref (info);
 		}
-		g_file_enumerator_close (enumerator, job->cancellable, NULL);
-		g_object_unref (enumerator);
+		child_enumerator_close (&children, job->cancellable);
 		
 		if (error && IS_IO_ERROR (error, CANCELLED)) {
 			g_error_free (error);
@@ -4224,68 +4880,286 @@ remove_target_recursively (CommonJob *job,
 		    IS_IO_ERROR (error, CANCELLED)) {
 			goto skip2;
 		}
-		primary = f (_("Error while copying “%B”."), src);
-		secondary = f (_("Could not remove the already existing file %F."), file);
-		details = error->message;
+		primary = f (_("Error while copying “%B”."), src);
+		secondary = f (_("Could not remove the already existing file %F."), file);
+		details = error->message;
+
+		/* set show_all to TRUE here, as we don't know how many
+		 * files we'll end up processing yet.
+		 */
+		response = run_warning (job,
+					primary,
+					secondary,
+					details,
+					TRUE,
+					CANCEL, SKIP_ALL, SKIP,
+					NULL);
+		
+		if (response == 0 || response == GTK_RESPONSE_DELETE_EVENT) {
+			abort_job (job);
+		} else if (response == 1) { /* skip all */
+			job->skip_all_error = TRUE;
+		} else if (response == 2) { /* skip */
+			/* do nothing */
+		} else {
+			g_assert_not_reached ();
+		}
+
+	skip2:
+		g_error_free (error);
+		
+		return FALSE;
+	}
+	nautilus_file_changes_queue_file_removed (file);
+	
+	return TRUE;
+	
+}
+
+typedef struct {
+	CopyMoveJob *job;
+	goffset last_size;
+	SourceInfo *source_info;
+	TransferInfo *transfer_info;
+} ProgressData;
+
+static void
+copy_file_progress_callback (goffset current_num_bytes,
+			     goffset total_num_bytes,
+			     gpointer user_data)
+{
+	ProgressData *pdata;
+	goffset new_size;
+
+	pdata = user_data;
+	
+	new_size = current_num_bytes - pdata->last_size;
+
+	if (new_size > 0) {
+		pdata->transfer_info->num_bytes += new_size;
+		pdata->last_size = current_num_bytes;
+		report_copy_progress (pdata->job,
+				      pdata->source_info,
+				      pdata->transfer_info);
+	}
+}
+
+/* Chunk size used for the kernel side copies, big enough to keep the
+ * syscall overhead negligible while still giving regular progress updates.
+ */
+#define NATIVE_COPY_CHUNK_SIZE (16 * 1024 * 1024)
+
+#if defined (__linux__) && !defined (FICLONE)
+#define FICLONE _IOW (0x94, 9, int)
+#endif
+
+typedef enum {
+	NATIVE_COPY_UNHANDLED,
+	NATIVE_COPY_SUCCESS,
+	NATIVE_COPY_FAILED
+} NativeCopyResult;
+
+static gboolean
+native_copy_is_unsupported_errno (int errsv)
+{
+	return errsv == ENOSYS || errsv == EXDEV || errsv == EINVAL ||
+	       errsv == EOPNOTSUPP || errsv == ENOTTY || errsv == EBADF;
+}
+
+/* Copies the data of a regular local file with the cheapest mechanism the
+ * kernel offers: a reflink clone first (btrfs, xfs, ...), then
+ * copy_file_range() and finally sendfile(). Anything this can't handle
+ * without side effects (symlinks, special files, existing destinations
+ * that need a conflict dialog, filesystems supporting none of the above)
+ * returns NATIVE_COPY_UNHANDLED, and the caller should use g_file_copy().
+ */
+static NativeCopyResult
+copy_file_native (GFile                 *src,
+		  GFile                 *dest,
+		  GFileCopyFlags         flags,
+		  GCancellable          *cancellable,
+		  GFileProgressCallback  progress_callback,
+		  gpointer               progress_callback_data,
+		  GError               **error)
+{
+	NativeCopyResult result;
+	char *src_path, *dest_path;
+	int src_fd, dest_fd;
+	int open_flags;
+	int errsv;
+	struct stat src_stat, dest_stat;
+	goffset offset;
+	gssize written;
+	gboolean created;
+	gboolean cloned;
+	gboolean use_sendfile;
+
+	if (!g_file_is_native (src) || !g_file_is_native (dest)) {
+		return NATIVE_COPY_UNHANDLED;
+	}
+
+	result = NATIVE_COPY_UNHANDLED;
+	src_fd = dest_fd = -1;
+	created = FALSE;
+
+	src_path = g_file_get_path (src);
+	dest_path = g_file_get_path (dest);
+	if (src_path == NULL || dest_path == NULL) {
+		goto out;
+	}
+
+	/* Only regular files are copied here; opening a FIFO or a device
+	 * could block forever, g_file_copy() refuses those instead.
+	 */
+	if (lstat (src_path, &src_stat) != 0 ||
+	    !S_ISREG (src_stat.st_mode)) {
+		goto out;
+	}
+
+	/* O_NOFOLLOW makes symlinks fail here, g_file_copy() copies them as links.
+	 * O_NONBLOCK keeps the open from hanging if the file was replaced
+	 * after the lstat().
+	 */
+	src_fd = open (src_path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+	if (src_fd < 0 ||
+	    fstat (src_fd, &src_stat) != 0 ||
+	    !S_ISREG (src_stat.st_mode)) {
+		goto out;
+	}
+
+	/* Only ever create the destination. An existing file is left to
+	 * g_file_copy(), which replaces it atomically, so that an error or
+	 * a cancel does not destroy it.
+	 */
+	open_flags = O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC;
+
+	/* The mode is fixed up by g_file_copy_attributes() below */
+	dest_fd = open (dest_path, open_flags, 0666);
+	if (dest_fd < 0) {
+		/* Let g_file_copy() produce the EXISTS, IS_DIRECTORY, ... errors,
+		 * or do the overwrite.
+		 */
+		goto out;
+	}
+	created = TRUE;
+
+	if (fstat (dest_fd, &dest_stat) != 0 ||
+	    !S_ISREG (dest_stat.st_mode)) {
+		goto fallback;
+	}
+
+	offset = 0;
+	cloned = FALSE;
+	use_sendfile = FALSE;
+
+#ifdef FICLONE
+	if (ioctl (dest_fd, FICLONE, src_fd) == 0) {
+		cloned = TRUE;
+		offset = src_stat.st_size;
+	}
+#endif
+
+	while (!cloned && offset < src_stat.st_size) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			goto failed;
+		}
+
+		written = -1;
+		errno = ENOSYS;
+#ifdef HAVE_COPY_FILE_RANGE
+		if (!use_sendfile) {
+			loff_t in_offset = offset;
+
+			written = copy_file_range (src_fd, &in_offset,
+						   dest_fd, NULL,
+						   NATIVE_COPY_CHUNK_SIZE, 0);
+			if (written < 0 && offset == 0 &&
+			    native_copy_is_unsupported_errno (errno)) {
+				use_sendfile = TRUE;
+			}
+		}
+#else
+		use_sendfile = TRUE;
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+		if (use_sendfile) {
+			off_t in_offset = offset;
+
+			written = sendfile (dest_fd, src_fd, &in_offset,
+					    NATIVE_COPY_CHUNK_SIZE);
+		}
+#endif
+
+		if (written < 0) {
+			errsv = errno;
+			if (errsv == EINTR) {
+				continue;
+			}
+			if (offset == 0 && native_copy_is_unsupported_errno (errsv)) {
+				goto fallback;
+			}
+			g_set_error_literal (error, G_IO_ERROR,
+					     g_io_error_from_errno (errsv),
+					     g_strerror (errsv));
+			goto failed;
+		}
+
+		if (written == 0) {
+			/* procfs, sysfs and some FUSE filesystems report a size
+			 * but give nothing to the kernel copy, read them the
+			 * normal way */
+			if (offset == 0) {
+				goto fallback;
+			}
+			/* The source shrunk under us, copy what is there */
+			break;
+		}
 
-		/* set show_all to TRUE here, as we don't know how many
-		 * files we'll end up processing yet.
-		 */
-		response = run_warning (job,
-					primary,
-					secondary,
-					details,
-					TRUE,
-					CANCEL, SKIP_ALL, SKIP,
-					NULL);
-		
-		if (response == 0 || response == GTK_RESPONSE_DELETE_EVENT) {
-			abort_job (job);
-		} else if (response == 1) { /* skip all */
-			job->skip_all_error = TRUE;
-		} else if (response == 2) { /* skip */
-			/* do nothing */
-		} else {
-			g_assert_not_reached ();
+		offset += written;
+		if (progress_callback) {
+			progress_callback (offset, src_stat.st_size, progress_callback_data);
 		}
+	}
 
-	skip2:
-		g_error_free (error);
-		
-		return FALSE;
+	if (close (dest_fd) != 0) {
+		dest_fd = -1;
+		errsv = errno;
+		g_set_error_literal (error, G_IO_ERROR,
+				     g_io_error_from_errno (errsv),
+				     g_strerror (errsv));
+		goto failed;
 	}
-	nautilus_file_changes_queue_file_removed (file);
-	
-	return TRUE;
-	
-}
+	dest_fd = -1;
 
-typedef struct {
-	CopyMoveJob *job;
-	goffset last_size;
-	SourceInfo *source_info;
-	TransferInfo *transfer_info;
-} ProgressData;
+	if (cloned && progress_callback) {
+		progress_callback (src_stat.st_size, src_stat.st_size, progress_callback_data);
+	}
 
-static void
-copy_file_progress_callback (goffset current_num_bytes,
-			     goffset total_num_bytes,
-			     gpointer user_data)
-{
-	ProgressData *pdata;
-	goffset new_size;
+	/* Ignore errors here. Failure to copy metadata is not a hard error */
+	g_file_copy_attributes (src, dest,
+				flags,
+				cancellable, NULL);
 
-	pdata = user_data;
-	
-	new_size = current_num_bytes - pdata->last_size;
+	result = NATIVE_COPY_SUCCESS;
+	goto out;
 
-	if (new_size > 0) {
-		pdata->transfer_info->num_bytes += new_size;
-		pdata->last_size = current_num_bytes;
-		report_copy_progress (pdata->job,
-				      pdata->source_info,
-				      pdata->transfer_info);
+ failed:
+	result = NATIVE_COPY_FAILED;
+ fallback:
+	if (created) {
+		unlink (dest_path);
 	}
+ out:
+	if (dest_fd >= 0) {
+		close (dest_fd);
+	}
+	if (src_fd >= 0) {
+		close (src_fd);
+	}
+	g_free (src_path);
+	g_free (dest_path);
+
+	return result;
 }
 
 static gboolean
@@ -4547,6 +5421,15 @@ copy_move_file (CopyMoveJob *copy_job,
 		return;
 	}
 
+	/* Moves only check the destination up front, as they always did */
+	if (!copy_job->is_move) {
+		verify_scanned_destination_size (job, dest_dir, source_info, transfer_info);
+		if (job_aborted (job)) {
+			*skipped_file = TRUE;
+			return;
+		}
+	}
+
 	unique_name_nr = 1;
 
 	/* another file in the same directory might have handled the invalid
@@ -4653,12 +5536,28 @@ copy_move_file (CopyMoveJob *copy_job,
 				   &pdata,
 				   &error);
 	} else {
-		res = g_file_copy (src, dest,
-				   flags,
-				   job->cancellable,
-				   copy_file_progress_callback,
-				   &pdata,
-				   &error);
+		switch (copy_file_native (src, dest,
+					  flags,
+					  job->cancellable,
+					  copy_file_progress_callback,
+					  &pdata,
+					  &error)) {
+		case NATIVE_COPY_SUCCESS:
+			res = TRUE;
+			break;
+		case NATIVE_COPY_FAILED:
+			res = FALSE;
+			break;
+		case NATIVE_COPY_UNHANDLED:
+		default:
+			res = g_file_copy (src, dest,
+					   flags,
+					   job->cancellable,
+					   copy_file_progress_callback,
+					   &pdata,
+					   &error);
+			break;
+		}
 	}
 	
 	if (res) {
@@ -5077,10 +5976,12 @@ copy_task_thread_func (GTask *task,
 		dest = g_file_get_parent (job->files->data);
 	}
 	
+	/* The free space is checked once the scan knows the total size,
+	 * if it does before the first bytes get written */
 	verify_destination (&job->common,
 			    dest,
 			    &dest_fs_id,
-			    source_info.num_bytes);
+			    -1);
 	g_object_unref (dest);
 	if (job_aborted (common)) {
 		goto aborted;
@@ -5093,8 +5994,14 @@ copy_task_thread_func (GTask *task,
 		    dest_fs_id,
 		    &source_info, &transfer_info);
 
+	if (!job_aborted (common)) {
+		finish_scanning_sources (&source_info, &transfer_info);
+		report_copy_progress (job, &source_info, &transfer_info);
+	}
+
  aborted:
-	
+	stop_scanning_sources (&source_info);
+
 	g_free (dest_fs_id);
 }
 
@@ -5470,6 +6377,130 @@ move_file_prepare (CopyMoveJob *move_job,
 	g_object_unref (dest);
 }
 
+/* Same filesystem moves of local files are renamed relative to the
+ * source and destination folders, opened once each, and the filesystem
+ * id is only looked up per source directory too. Everything that doesn't
+ * go through cleanly (conflicts, moving into itself, other filesystems
+ * mounted in the sources, ...) is handed to move_file_prepare().
+ */
+typedef struct {
+	gboolean same_fs;
+	NautilusNativeDir *native;
+} MoveSourceDir;
+
+typedef struct {
+	GList *sources;
+	GList *targets;
+	GList *positions;
+} MoveBatch;
+
+static void
+move_source_dir_free (MoveSourceDir *source_dir)
+{
+	nautilus_native_dir_close (source_dir->native);
+	g_free (source_dir);
+}
+
+static MoveSourceDir *
+get_move_source_dir (GHashTable *source_dirs,
+		     GFile *src,
+		     const char *dest_fs_id,
+		     NautilusNativeDir *dest_native)
+{
+	MoveSourceDir *source_dir;
+	GFile *parent;
+
+	parent = g_file_get_parent (src);
+	if (parent == NULL) {
+		return NULL;
+	}
+
+	source_dir = g_hash_table_lookup (source_dirs, parent);
+	if (source_dir == NULL) {
+		source_dir = g_new0 (MoveSourceDir, 1);
+		source_dir->same_fs = dest_fs_id != NULL && has_fs_id (parent, dest_fs_id);
+		if (source_dir->same_fs && dest_native != NULL) {
+			source_dir->native = nautilus_native_dir_open (parent, NULL);
+		}
+
+		g_hash_table_insert (source_dirs, g_object_ref (parent), source_dir);
+	}
+
+	g_object_unref (parent);
+
+	return source_dir;
+}
+
+static gboolean
+move_file_rename_native (CopyMoveJob *move_job,
+			 GFile *src,
+			 NautilusNativeDir *src_native,
+			 NautilusNativeDir *dest_native,
+			 GdkPoint *position,
+			 MoveBatch *batch)
+{
+	GFile *dest;
+	char *name;
+
+	if (test_dir_is_parent (move_job->destination, src)) {
+		return FALSE;
+	}
+
+	name = g_file_get_basename (src);
+	if (!nautilus_native_dir_rename (src_native, name, dest_native, name, NULL)) {
+		g_free (name);
+		return FALSE;
+	}
+
+	dest = g_file_get_child (move_job->destination, name);
+	g_free (name);
+
+	if (move_job->debuting_files) {
+		g_hash_table_replace (move_job->debuting_files, g_object_ref (dest), GINT_TO_POINTER (TRUE));
+	}
+
+	batch->sources = g_list_prepend (batch->sources, g_object_ref (src));
+	batch->targets = g_list_prepend (batch->targets, dest);
+	batch->positions = g_list_prepend (batch->positions,
+					   position != NULL ? g_memdup (position, sizeof (GdkPoint)) : NULL);
+
+	return TRUE;
+}
+
+static void
+move_batch_flush (CopyMoveJob *move_job,
+		  MoveBatch *batch)
+{
+	CommonJob *job;
+	GList *t, *p;
+
+	job = (CommonJob *)move_job;
+
+	batch->sources = g_list_reverse (batch->sources);
+	batch->targets = g_list_reverse (batch->targets);
+	batch->positions = g_list_reverse (batch->positions);
+
+	nautilus_file_changes_queue_files_moved (batch->sources, batch->targets);
+
+	for (t = batch->targets, p = batch->positions; t != NULL; t = t->next, p = p->next) {
+		if (p->data != NULL) {
+			nautilus_file_changes_queue_schedule_position_set (t->data, *(GdkPoint *)p->data, job->screen_num);
+		} else {
+			nautilus_file_changes_queue_schedule_position_remove (t->data);
+		}
+	}
+
+	if (job->undo_info != NULL) {
+		nautilus_file_undo_info_ext_add_origin_target_pairs (NAUTILUS_FILE_UNDO_INFO_EXT (job->undo_info),
+								     batch->sources, batch->targets);
+	}
+
+	g_list_free_full (batch->sources, g_object_unref);
+	g_list_free_full (batch->targets, g_object_unref);
+	g_list_free_full (batch->positions, g_free);
+	memset (batch, 0, sizeof (MoveBatch));
+}
+
 static void
 move_files_prepare (CopyMoveJob *job,
 		    const char *dest_fs_id,
@@ -5483,6 +6514,10 @@ move_files_prepare (CopyMoveJob *job,
 	int i;
 	GdkPoint *point;
 	int total, left;
+	GHashTable *source_dirs;
+	MoveSourceDir *source_dir;
+	MoveBatch batch;
+	NautilusNativeDir *dest_native;
 
 	common = &job->common;
 
@@ -5490,6 +6525,14 @@ move_files_prepare (CopyMoveJob *job,
 
 	report_preparing_move_progress (job, total, left);
 
+	source_dirs = g_hash_table_new_full (g_file_hash, (GEqualFunc)g_file_equal,
+					     g_object_unref, (GDestroyNotify)move_source_dir_free);
+	dest_native = NULL;
+	if (dest_fs_id != NULL) {
+		dest_native = nautilus_native_dir_open (job->destination, NULL);
+	}
+	memset (&batch, 0, sizeof (batch));
+
 	i = 0;
 	for (l = job->files;
 	     l != NULL && !job_aborted (common);
@@ -5502,25 +6545,34 @@ move_files_prepare (CopyMoveJob *job,
 			point = NULL;
 		}
 
-		
-		same_fs = FALSE;
-		if (dest_fs_id) {
-			same_fs = has_fs_id (src, dest_fs_id);
+		source_dir = get_move_source_dir (source_dirs, src, dest_fs_id, dest_native);
+		same_fs = source_dir != NULL && source_dir->same_fs;
+
+		if (source_dir == NULL || source_dir->native == NULL ||
+		    !move_file_rename_native (job, src,
+					      source_dir->native, dest_native,
+					      point, &batch)) {
+			move_file_prepare (job, src, job->destination,
+					   same_fs, dest_fs_type,
+					   job->debuting_files,
+					   point,
+					   fallbacks,
+					   left);
+		}
+
+		--left;
+		if (left == 0 || left % 100 == 0) {
+			report_preparing_move_progress (job, total, left);
 		}
-		
-		move_file_prepare (job, src, job->destination,
-				   same_fs, dest_fs_type,
-				   job->debuting_files,
-				   point,
-				   fallbacks,
-				   left);
-		report_preparing_move_progress (job, total, --left);
 		i++;
 	}
 
-	*fallbacks = g_list_reverse (*fallbacks);
+	move_batch_flush (job, &batch);
 
-	
+	nautilus_native_dir_close (dest_native);
+	g_hash_table_destroy (source_dirs);
+
+	*fallbacks = g_list_reverse (*fallbacks);
 }
 
 static void
@@ -5649,15 +6701,7 @@ move_task_thread_func (GTask *task,
 	g_list_free (fallback_files);
 	
 	if (job_aborted (common)) {
-		goto aborted;
-	}
-
-	verify_destination (&job->common,
-			    job->destination,
-			    NULL,
-			    source_info.num_bytes);
-	if (job_aborted (common)) {
-		goto aborted;
+		goto aborted_scanning;
 	}
 
 	memset (&transfer_info, 0, sizeof (transfer_info));
@@ -5666,6 +6710,13 @@ move_task_thread_func (GTask *task,
 		    dest_fs_id, &dest_fs_type,
 		    &source_info, &transfer_info);
 
+	if (!job_aborted (common)) {
+		finish_scanning_sources (&source_info, &transfer_info);
+		report_copy_progress (job, &source_info, &transfer_info);
+	}
+
+ aborted_scanning:
+	stop_scanning_sources (&source_info);
  aborted:
 	g_list_free_full (fallbacks, g_free);
 
@@ -6111,6 +7162,231 @@ set_permissions_task_done (GObject *source_object,
 	finalize_common ((CommonJob *)job);
 }
 
+/* Local folders are changed on a thread pool: every folder is read and
+ * its entries are changed relative to the folder fd, without a GFileInfo
+ * per child, and subfolders are pushed back to the pool. Symlinks are
+ * skipped, GIO can't change their mode either. Only the entries whose
+ * mode actually changes are touched and recorded for undo, grouped by
+ * their original mode. Subfolders are opened relative to their parent,
+ * which their task keeps open; the deepest ones go first so that few
+ * parents are held open at a time.
+ */
+#define PERMISSIONS_MAX_THREADS 8
+
+typedef struct {
+	/* Either the folder, for the toplevel one, or its parent and name */
+	NautilusNativeDir *native;
+	NautilusNativeDir *parent;
+	char *name;
+	int depth;
+} NativePermissionsTask;
+
+static NativePermissionsTask *
+native_permissions_task_new (NautilusNativeDir *native,
+			     NautilusNativeDir *parent,
+			     char *name,
+			     int depth)
+{
+	NativePermissionsTask *task;
+
+	task = g_new (NativePermissionsTask, 1);
+	task->native = native;
+	task->parent = parent;
+	task->name = name;
+	task->depth = depth;
+
+	return task;
+}
+
+static gint
+native_permissions_task_compare_depth (gconstpointer a,
+				       gconstpointer b,
+				       gpointer user_data)
+{
+	return ((const NativePermissionsTask *) b)->depth -
+		((const NativePermissionsTask *) a)->depth;
+}
+
+typedef struct {
+	SetPermissionsJob *job;
+	GThreadPool *pool;
+	volatile gint pending;
+
+	GMutex mutex;
+	GCond cond;
+	gboolean done;
+} NativePermissionsData;
+
+static void
+native_permissions_finish_dir (NativePermissionsData *data)
+{
+	if (g_atomic_int_dec_and_test (&data->pending)) {
+		g_mutex_lock (&data->mutex);
+		data->done = TRUE;
+		g_cond_signal (&data->cond);
+		g_mutex_unlock (&data->mutex);
+	}
+}
+
+static void
+native_permissions_add_undo (NativePermissionsData *data,
+			     GHashTable *originals)
+{
+	NautilusFileUndoInfoRecPermissions *undo_info;
+	GHashTableIter iter;
+	gpointer key, value;
+	GPtrArray *uris;
+
+	undo_info = NAUTILUS_FILE_UNDO_INFO_REC_PERMISSIONS (data->job->common.undo_info);
+
+	g_mutex_lock (&data->mutex);
+	g_hash_table_iter_init (&iter, originals);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		uris = value;
+		nautilus_file_undo_info_rec_permissions_add_uris (undo_info,
+								  GPOINTER_TO_UINT (key),
+								  (gchar **) uris->pdata,
+								  uris->len);
+		/* The strings belong to the undo info now */
+		g_ptr_array_free (uris, TRUE);
+	}
+	g_mutex_unlock (&data->mutex);
+}
+
+static void
+native_permissions_thread_func (gpointer task_data,
+				gpointer user_data)
+{
+	NativePermissionsData *data = user_data;
+	SetPermissionsJob *job;
+	NativePermissionsTask *task = task_data;
+	int depth;
+	NautilusNativeDir *native;
+	const NautilusNativeDirEntry *entry;
+	GHashTable *originals;
+	GPtrArray *uris;
+	struct stat statbuf;
+	guint32 current;
+	guint32 value;
+	char *child_path;
+
+	job = data->job;
+
+	depth = task->depth;
+	native = task->native;
+	if (native == NULL && !job_aborted ((CommonJob *) job)) {
+		native = nautilus_native_dir_open_child (task->parent, task->name, NULL);
+	}
+	nautilus_native_dir_close (task->parent);
+	g_free (task->name);
+	g_free (task);
+
+	if (job_aborted ((CommonJob *) job)) {
+		nautilus_native_dir_close (native);
+		native = NULL;
+	}
+
+	if (native == NULL) {
+		native_permissions_finish_dir (data);
+		return;
+	}
+
+	originals = NULL;
+	if (job->common.undo_info != NULL) {
+		originals = g_hash_table_new (NULL, NULL);
+	}
+
+	while (!job_aborted ((CommonJob *) job) &&
+	       (entry = nautilus_native_dir_next (native, NULL)) != NULL) {
+		/* Ignore errors */
+		if (!nautilus_native_dir_stat (native, entry->name, &statbuf, NULL) ||
+		    S_ISLNK (statbuf.st_mode)) {
+			continue;
+		}
+
+		current = statbuf.st_mode & 07777;
+		if (S_ISDIR (statbuf.st_mode)) {
+			value = (current & ~job->dir_mask) | job->dir_permissions;
+		} else {
+			value = (current & ~job->file_mask) | job->file_permissions;
+		}
+
+		if (value != current &&
+		    nautilus_native_dir_chmod (native, entry->name, value, NULL)) {
+			if (originals != NULL) {
+				uris = g_hash_table_lookup (originals, GUINT_TO_POINTER (current));
+				if (uris == NULL) {
+					uris = g_ptr_array_new ();
+					g_hash_table_insert (originals, GUINT_TO_POINTER (current), uris);
+				}
+				child_path = nautilus_native_dir_get_child_path (native, entry->name);
+				g_ptr_array_add (uris, g_filename_to_uri (child_path, NULL, NULL));
+				g_free (child_path);
+			}
+		}
+
+		if (S_ISDIR (statbuf.st_mode)) {
+			g_atomic_int_inc (&data->pending);
+			g_thread_pool_push (data->pool,
+					    native_permissions_task_new (NULL,
+									 nautilus_native_dir_ref (native),
+									 g_strdup (entry->name),
+									 depth + 1),
+					    NULL);
+		}
+	}
+
+	nautilus_native_dir_close (native);
+
+	if (originals != NULL) {
+		native_permissions_add_undo (data, originals);
+		g_hash_table_destroy (originals);
+	}
+
+	native_permissions_finish_dir (data);
+}
+
+/* Takes over @native */
+static void
+set_permissions_native_dir (SetPermissionsJob *job,
+			    NautilusNativeDir *native)
+{
+	NativePermissionsData data;
+	CommonJob *common;
+
+	common = (CommonJob *)job;
+
+	memset (&data, 0, sizeof (data));
+	data.job = job;
+	data.pending = 1;
+	g_mutex_init (&data.mutex);
+	g_cond_init (&data.cond);
+	data.pool = g_thread_pool_new (native_permissions_thread_func, &data,
+				       MIN (g_get_num_processors (), PERMISSIONS_MAX_THREADS),
+				       FALSE, NULL);
+	g_thread_pool_set_sort_function (data.pool, native_permissions_task_compare_depth, NULL);
+
+	g_thread_pool_push (data.pool, native_permissions_task_new (native, NULL, NULL, 0), NULL);
+
+	/* Batch the progress updates instead of pulsing for every file */
+	g_mutex_lock (&data.mutex);
+	while (!data.done) {
+		g_cond_wait_until (&data.cond, &data.mutex,
+				   g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND);
+		g_mutex_unlock (&data.mutex);
+
+		nautilus_progress_info_pulse_progress (common->progress);
+
+		g_mutex_lock (&data.mutex);
+	}
+	g_mutex_unlock (&data.mutex);
+
+	g_thread_pool_free (data.pool, FALSE, TRUE);
+
+	g_mutex_clear (&data.mutex);
+	g_cond_clear (&data.cond);
+}
+
 static void
 set_permissions_file (SetPermissionsJob *job,
 		      GFile *file,
@@ -6124,6 +7400,7 @@ set_permissions_file (SetPermissionsJob *job,
 	guint32 mask;
 	GFileEnumerator *enumerator;
 	GFile *child;
+	NautilusNativeDir *native;
 	
 	common = (CommonJob *)job;
 
@@ -6169,8 +7446,17 @@ set_permissions_file (SetPermissionsJob *job,
 					     common->cancellable, NULL);
 	}
 	
+	native = NULL;
 	if (!job_aborted (common) &&
-	    g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+	    g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY &&
+	    g_file_is_native (file)) {
+		native = nautilus_native_dir_open (file, NULL);
+	}
+
+	if (native != NULL) {
+		set_permissions_native_dir (job, native);
+	} else if (!job_aborted (common) &&
+		   g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
 		enumerator = g_file_enumerate_children (file,
 							G_FILE_ATTRIBUTE_STANDARD_NAME","
 							G_FILE_ATTRIBUTE_STANDARD_TYPE","
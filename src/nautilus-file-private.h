@@ -135,6 +135,9 @@ struct NautilusFileDetails
            many NautilusFile objects. */
 
 	eel_boolean_bit unconfirmed                   : 1;
+	/* Only known from the last listing saved to disk, see
+	 * nautilus-directory-snapshot.h */
+	eel_boolean_bit from_snapshot                 : 1;
 	eel_boolean_bit is_gone                       : 1;
 	/* Set when emitting files_added on the directory to make sure we
 	   add a file, and only once */
@@ -245,6 +248,8 @@ gboolean      nautilus_file_update_name                    (NautilusFile
 							    const char             *name);
 gboolean      nautilus_file_update_metadata_from_info      (NautilusFile           *file,
 							    GFileInfo              *info);
+gboolean      nautilus_file_merge_metadata_from_info       (NautilusFile           *file,
+							    GFileInfo              *info);
 
 gboolean      nautilus_file_update_name_and_directory      (NautilusFile           *file,
 							    const char             *name,
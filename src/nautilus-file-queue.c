@@ -120,3 +120,29 @@ nautilus_file_queue_is_empty (NautilusFileQueue *queue)
 {
 	return (queue->head == NULL);
 }
+
+void
+nautilus_file_queue_prioritize (NautilusFileQueue *queue,
+				NautilusFile *file)
+{
+	GList *link;
+
+	link = g_hash_table_lookup (queue->item_to_link_map, file);
+
+	if (link == NULL || link == queue->head) {
+		return;
+	}
+
+	if (link == queue->tail) {
+		queue->tail = queue->tail->prev;
+	}
+
+	queue->head = g_list_remove_link (queue->head, link);
+	queue->head = g_list_concat (link, queue->head);
+}
+
+GList *
+nautilus_file_queue_peek (NautilusFileQueue *queue)
+{
+	return queue->head;
+}
@@ -46,4 +46,11 @@ NautilusFile *     nautilus_file_queue_head     (NautilusFileQueue *queue);
 
 gboolean           nautilus_file_queue_is_empty (NautilusFileQueue *queue);
 
+/* Move a file already in the queue to its head, in constant time. */
+void               nautilus_file_queue_prioritize (NautilusFileQueue *queue,
+						   NautilusFile      *file);
+
+/* The files in queue order. The list belongs to the queue. */
+GList *            nautilus_file_queue_peek     (NautilusFileQueue *queue);
+
 #endif /* NAUTILUS_FILE_CHANGES_QUEUE_H */
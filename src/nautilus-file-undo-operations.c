@@ -24,10 +24,14 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "nautilus-file-undo-operations.h"
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include "nautilus-file-operations.h"
 #include "nautilus-file.h"
@@ -324,27 +328,304 @@ file_undo_info_delete_callback (GHashTable *debuting_uris,
 				       user_cancel);
 }
 
+/* Compact log of the locations touched by an operation. A copy or move
+ * of a big tree records every file in it, so instead of a GFile per entry
+ * the URIs are stored back to back, each one as the length of the prefix
+ * it shares with the previous URI followed by the rest of it. Past
+ * UNDO_LOG_MEMORY_BUDGET bytes the log is appended to an unlinked
+ * temporary file. The GFiles are only created when the log is replayed.
+ */
+#define UNDO_LOG_MEMORY_BUDGET (512 * 1024)
+#define UNDO_LOG_READ_SIZE (64 * 1024)
+
+typedef struct {
+	GByteArray *arena;
+	GString *last;
+	int spill_fd;
+	goffset spilled;
+} UndoLog;
+
+typedef struct {
+	const UndoLog *log;
+	guchar buffer[UNDO_LOG_READ_SIZE];
+	const guchar *data;
+	gsize pos;
+	gsize len;
+	goffset offset;
+	gboolean in_arena;
+} UndoLogReader;
+
+static void
+undo_log_init (UndoLog *log)
+{
+	log->arena = g_byte_array_new ();
+	log->last = g_string_new (NULL);
+	log->spill_fd = -1;
+	log->spilled = 0;
+}
+
+static void
+undo_log_clear (UndoLog *log)
+{
+	g_byte_array_unref (log->arena);
+	g_string_free (log->last, TRUE);
+
+	if (log->spill_fd >= 0) {
+		close (log->spill_fd);
+	}
+}
+
+static void
+undo_log_put_varint (GByteArray *arena,
+		     gsize value)
+{
+	guint8 byte;
+
+	do {
+		byte = value & 0x7f;
+		value >>= 7;
+		if (value != 0) {
+			byte |= 0x80;
+		}
+		g_byte_array_append (arena, &byte, 1);
+	} while (value != 0);
+}
+
+static void
+undo_log_spill (UndoLog *log)
+{
+	char *tmp_name;
+	gsize written;
+	gssize res;
+
+	if (log->spill_fd < 0) {
+		log->spill_fd = g_file_open_tmp ("nautilus-undo-XXXXXX", &tmp_name, NULL);
+		if (log->spill_fd < 0) {
+			/* Keep everything in memory then */
+			return;
+		}
+		/* Nobody else needs to see it, and it goes away with us */
+		g_unlink (tmp_name);
+		g_free (tmp_name);
+	}
+
+	written = 0;
+	while (written < log->arena->len) {
+		res = write (log->spill_fd, log->arena->data + written, log->arena->len - written);
+		if (res < 0 && errno == EINTR) {
+			continue;
+		}
+		if (res <= 0) {
+			/* Drop what went out partially and keep the rest in memory */
+			if (ftruncate (log->spill_fd, log->spilled) == 0) {
+				lseek (log->spill_fd, log->spilled, SEEK_SET);
+			}
+			return;
+		}
+		written += res;
+	}
+
+	log->spilled += written;
+	g_byte_array_set_size (log->arena, 0);
+}
+
+static void
+undo_log_append (UndoLog *log,
+		 GFile *file)
+{
+	char *uri;
+	gsize len;
+	gsize prefix;
+
+	uri = g_file_get_uri (file);
+	len = strlen (uri);
+
+	prefix = 0;
+	while (prefix < len && prefix < log->last->len &&
+	       uri[prefix] == log->last->str[prefix]) {
+		prefix++;
+	}
+
+	undo_log_put_varint (log->arena, prefix);
+	undo_log_put_varint (log->arena, len - prefix);
+	g_byte_array_append (log->arena, (const guint8 *) uri + prefix, len - prefix);
+
+	g_string_truncate (log->last, prefix);
+	g_string_append (log->last, uri + prefix);
+
+	g_free (uri);
+
+	if (log->arena->len > UNDO_LOG_MEMORY_BUDGET) {
+		undo_log_spill (log);
+	}
+}
+
+static UndoLogReader *
+undo_log_reader_new (const UndoLog *log)
+{
+	UndoLogReader *reader;
+
+	reader = g_new0 (UndoLogReader, 1);
+	reader->log = log;
+
+	return reader;
+}
+
+static gboolean
+undo_log_reader_get_byte (UndoLogReader *reader,
+			  guchar *byte)
+{
+	const UndoLog *log;
+	gssize res;
+
+	log = reader->log;
+
+	while (reader->pos == reader->len) {
+		if (reader->in_arena) {
+			return FALSE;
+		}
+
+		if (reader->offset < log->spilled) {
+			res = pread (log->spill_fd, reader->buffer,
+				     MIN (sizeof (reader->buffer), log->spilled - reader->offset),
+				     reader->offset);
+			if (res < 0 && errno == EINTR) {
+				continue;
+			}
+			if (res <= 0) {
+				return FALSE;
+			}
+			reader->data = reader->buffer;
+			reader->len = res;
+			reader->offset += res;
+		} else {
+			reader->data = log->arena->data;
+			reader->len = log->arena->len;
+			reader->in_arena = TRUE;
+		}
+		reader->pos = 0;
+	}
+
+	*byte = reader->data[reader->pos++];
+
+	return TRUE;
+}
+
+static gboolean
+undo_log_reader_get_varint (UndoLogReader *reader,
+			    gsize *value)
+{
+	guchar byte;
+	guint shift;
+
+	*value = 0;
+	shift = 0;
+	do {
+		if (!undo_log_reader_get_byte (reader, &byte)) {
+			return FALSE;
+		}
+		*value |= (gsize) (byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	return TRUE;
+}
+
+/* Decodes the next URI into @current, which holds the previous one */
+static gboolean
+undo_log_reader_next (UndoLogReader *reader,
+		      GString *current)
+{
+	gsize prefix, len, i;
+	guchar byte;
+
+	if (!undo_log_reader_get_varint (reader, &prefix) ||
+	    !undo_log_reader_get_varint (reader, &len) ||
+	    prefix > current->len) {
+		return FALSE;
+	}
+
+	g_string_truncate (current, prefix);
+	for (i = 0; i < len; i++) {
+		if (!undo_log_reader_get_byte (reader, &byte)) {
+			return FALSE;
+		}
+		g_string_append_c (current, byte);
+	}
+
+	return TRUE;
+}
+
+/* Returns a new list of GFiles, in the order they were logged unless
+ * @reversed is set. */
+static GList *
+undo_log_get_files (const UndoLog *log,
+		    gboolean reversed)
+{
+	UndoLogReader *reader;
+	GString *current;
+	GList *files;
+
+	reader = undo_log_reader_new (log);
+	current = g_string_new (NULL);
+	files = NULL;
+
+	while (undo_log_reader_next (reader, current)) {
+		files = g_list_prepend (files, g_file_new_for_uri (current->str));
+	}
+
+	g_string_free (current, TRUE);
+	g_free (reader);
+
+	if (!reversed) {
+		files = g_list_reverse (files);
+	}
+
+	return files;
+}
+
+static GFile *
+undo_log_get_first_file (const UndoLog *log)
+{
+	UndoLogReader *reader;
+	GString *current;
+	GFile *file;
+
+	reader = undo_log_reader_new (log);
+	current = g_string_new (NULL);
+
+	file = NULL;
+	if (undo_log_reader_next (reader, current)) {
+		file = g_file_new_for_uri (current->str);
+	}
+
+	g_string_free (current, TRUE);
+	g_free (reader);
+
+	return file;
+}
+
 /* copy/move/duplicate/link/restore from trash */
 G_DEFINE_TYPE (NautilusFileUndoInfoExt, nautilus_file_undo_info_ext, NAUTILUS_TYPE_FILE_UNDO_INFO)
 
 struct _NautilusFileUndoInfoExtDetails {
 	GFile *src_dir;
 	GFile *dest_dir;
-	GList *sources;	     /* Relative to src_dir */
-	GList *destinations; /* Relative to dest_dir */
+	UndoLog sources;
+	UndoLog destinations;
 };
 
 static char *
 ext_get_first_target_short_name (NautilusFileUndoInfoExt *self)
 {
-	GList *targets_first;
+	GFile *first;
 	char *file_name = NULL;
 
-	targets_first = g_list_first (self->priv->destinations);
+	first = undo_log_get_first_file (&self->priv->destinations);
 
-	if (targets_first != NULL &&
-	    targets_first->data != NULL) {
-		file_name = g_file_get_basename (targets_first->data);
+	if (first != NULL) {
+		file_name = g_file_get_basename (first);
+		g_object_unref (first);
 	}
 
 	return file_name;
@@ -479,35 +760,51 @@ static void
 ext_create_link_redo_func (NautilusFileUndoInfoExt *self,
 			   GtkWindow *parent_window)
 {
-	nautilus_file_operations_link (self->priv->sources, NULL,
+	GList *sources;
+
+	sources = undo_log_get_files (&self->priv->sources, FALSE);
+	nautilus_file_operations_link (sources, NULL,
 				       self->priv->dest_dir, parent_window,
 				       file_undo_info_transfer_callback, self);
+	g_list_free_full (sources, g_object_unref);
 }
 
 static void
 ext_duplicate_redo_func (NautilusFileUndoInfoExt *self,
 			 GtkWindow *parent_window)
 {
-	nautilus_file_operations_duplicate (self->priv->sources, NULL, parent_window,
+	GList *sources;
+
+	sources = undo_log_get_files (&self->priv->sources, FALSE);
+	nautilus_file_operations_duplicate (sources, NULL, parent_window,
 					    file_undo_info_transfer_callback, self);
+	g_list_free_full (sources, g_object_unref);
 }
 
 static void
 ext_copy_redo_func (NautilusFileUndoInfoExt *self,
 		    GtkWindow *parent_window)
 {
-	nautilus_file_operations_copy (self->priv->sources, NULL,
+	GList *sources;
+
+	sources = undo_log_get_files (&self->priv->sources, FALSE);
+	nautilus_file_operations_copy (sources, NULL,
 				       self->priv->dest_dir, parent_window,
 				       file_undo_info_transfer_callback, self);
+	g_list_free_full (sources, g_object_unref);
 }
 
 static void
 ext_move_restore_redo_func (NautilusFileUndoInfoExt *self,
 			    GtkWindow *parent_window)
 {
-	nautilus_file_operations_move (self->priv->sources, NULL,
+	GList *sources;
+
+	sources = undo_log_get_files (&self->priv->sources, FALSE);
+	nautilus_file_operations_move (sources, NULL,
 				       self->priv->dest_dir, parent_window,
 				       file_undo_info_transfer_callback, self);
+	g_list_free_full (sources, g_object_unref);
 }
 
 static void
@@ -535,8 +832,12 @@ static void
 ext_restore_undo_func (NautilusFileUndoInfoExt *self,
 		       GtkWindow *parent_window)
 {
-	nautilus_file_operations_trash_or_delete (self->priv->destinations, parent_window,
+	GList *destinations;
+
+	destinations = undo_log_get_files (&self->priv->destinations, FALSE);
+	nautilus_file_operations_trash_or_delete (destinations, parent_window,
 						  file_undo_info_delete_callback, self);
+	g_list_free_full (destinations, g_object_unref);
 }
 
 
@@ -544,9 +845,13 @@ static void
 ext_move_undo_func (NautilusFileUndoInfoExt *self,
 		    GtkWindow *parent_window)
 {
-	nautilus_file_operations_move (self->priv->destinations, NULL,
+	GList *destinations;
+
+	destinations = undo_log_get_files (&self->priv->destinations, FALSE);
+	nautilus_file_operations_move (destinations, NULL,
 				       self->priv->src_dir, parent_window,
 				       file_undo_info_transfer_callback, self);
+	g_list_free_full (destinations, g_object_unref);
 }
 
 static void
@@ -555,13 +860,13 @@ ext_copy_duplicate_undo_func (NautilusFileUndoInfoExt *self,
 {
 	GList *files;
 
-	files = g_list_copy (self->priv->destinations);
-	files = g_list_reverse (files); /* Deleting must be done in reverse */
+	/* Deleting must be done in reverse */
+	files = undo_log_get_files (&self->priv->destinations, TRUE);
 
 	nautilus_file_operations_delete (files, parent_window,
 					 file_undo_info_delete_callback, self);
 
-	g_list_free (files);
+	g_list_free_full (files, g_object_unref);
 }
 
 static void
@@ -589,6 +894,9 @@ nautilus_file_undo_info_ext_init (NautilusFileUndoInfoExt *self)
 {
 	self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, nautilus_file_undo_info_ext_get_type (),
 						  NautilusFileUndoInfoExtDetails);
+
+	undo_log_init (&self->priv->sources);
+	undo_log_init (&self->priv->destinations);
 }
 
 static void
@@ -596,13 +904,8 @@ nautilus_file_undo_info_ext_finalize (GObject *obj)
 {
 	NautilusFileUndoInfoExt *self = NAUTILUS_FILE_UNDO_INFO_EXT (obj);
 
-	if (self->priv->sources) {
-		g_list_free_full (self->priv->sources, g_object_unref);
-	}
-
-	if (self->priv->destinations) {
-		g_list_free_full (self->priv->destinations, g_object_unref);
-	}
+	undo_log_clear (&self->priv->sources);
+	undo_log_clear (&self->priv->destinations);
 
 	g_clear_object (&self->priv->src_dir);
 	g_clear_object (&self->priv->dest_dir);
@@ -649,10 +952,21 @@ nautilus_file_undo_info_ext_add_origin_target_pair (NautilusFileUndoInfoExt *sel
 						    GFile                   *origin,
 						    GFile                   *target)
 {
-	self->priv->sources =
-		g_list_append (self->priv->sources, g_object_ref (origin));
-	self->priv->destinations =
-		g_list_append (self->priv->destinations, g_object_ref (target));
+	undo_log_append (&self->priv->sources, origin);
+	undo_log_append (&self->priv->destinations, target);
+}
+
+void
+nautilus_file_undo_info_ext_add_origin_target_pairs (NautilusFileUndoInfoExt *self,
+						     GList                   *origins,
+						     GList                   *targets)
+{
+	GList *o, *t;
+
+	for (o = origins, t = targets; o != NULL && t != NULL; o = o->next, t = t->next) {
+		undo_log_append (&self->priv->sources, o->data);
+		undo_log_append (&self->priv->destinations, t->data);
+	}
 }
 
 /* create new file/folder */
@@ -982,8 +1296,143 @@ G_DEFINE_TYPE (NautilusFileUndoInfoTrash, nautilus_file_undo_info_trash, NAUTILU
 
 struct _NautilusFileUndoInfoTrashDetails {
 	GHashTable *trashed;
+	/* GFile -> TrashItem, for the files that went to the home trash */
+	GHashTable *trash_items;
 };
 
+/* Where a file ended up in the home trash. Undo restores it from there
+ * directly, instead of looking for it among everything in the trash.
+ */
+typedef struct {
+	char *name;
+	char *deletion_date;
+} TrashItem;
+
+static void
+trash_item_free (TrashItem *item)
+{
+	g_free (item->name);
+	g_free (item->deletion_date);
+	g_free (item);
+}
+
+static char *
+get_home_trash_path (const char *subdir,
+		     const char *name,
+		     const char *suffix)
+{
+	char *filename, *path;
+
+	filename = g_strconcat (name, suffix, NULL);
+	path = g_build_filename (g_get_user_data_dir (), "Trash", subdir, filename, NULL);
+	g_free (filename);
+
+	return path;
+}
+
+/* Returns the deletion date of the home trash item @name if it was
+ * trashed from @orig_path, NULL otherwise. */
+static char *
+read_home_trash_info (const char *name,
+		      const char *orig_path)
+{
+	GKeyFile *key_file;
+	char *info_path;
+	char *path, *unescaped, *date;
+
+	info_path = get_home_trash_path ("info", name, ".trashinfo");
+	key_file = g_key_file_new ();
+	date = NULL;
+
+	if (g_key_file_load_from_file (key_file, info_path, G_KEY_FILE_NONE, NULL)) {
+		path = g_key_file_get_string (key_file, "Trash Info", "Path", NULL);
+		unescaped = path != NULL ? g_uri_unescape_string (path, NULL) : NULL;
+
+		if (g_strcmp0 (unescaped, orig_path) == 0) {
+			date = g_key_file_get_string (key_file, "Trash Info", "DeletionDate", NULL);
+		}
+
+		g_free (unescaped);
+		g_free (path);
+	}
+
+	g_key_file_free (key_file);
+	g_free (info_path);
+
+	return date;
+}
+
+/* Same naming as GIO uses for the items of the home trash */
+static char *
+get_trash_item_name (const char *basename,
+		     int id)
+{
+	const char *dot;
+
+	if (id == 1) {
+		return g_strdup (basename);
+	}
+
+	dot = strchr (basename, '.');
+	if (dot != NULL) {
+		return g_strdup_printf ("%.*s.%d%s", (int) (dot - basename), basename, id, dot);
+	}
+
+	return g_strdup_printf ("%s.%d", basename, id);
+}
+
+/* Finds the home trash item @file was just moved to. GIO takes the first
+ * free name, so only the names up to the first free one are checked, and
+ * the latest deletion wins if the same file was trashed more than once. */
+static TrashItem *
+find_home_trash_item (GFile *file)
+{
+	TrashItem *item;
+	char *orig_path, *basename;
+	char *name, *info_path, *date;
+	int id;
+
+	orig_path = g_file_get_path (file);
+	basename = g_file_get_basename (file);
+	if (orig_path == NULL || basename == NULL) {
+		g_free (orig_path);
+		g_free (basename);
+		return NULL;
+	}
+
+	item = NULL;
+	for (id = 1; ; id++) {
+		name = get_trash_item_name (basename, id);
+		info_path = get_home_trash_path ("info", name, ".trashinfo");
+		if (!g_file_test (info_path, G_FILE_TEST_EXISTS)) {
+			g_free (info_path);
+			g_free (name);
+			break;
+		}
+		g_free (info_path);
+
+		date = read_home_trash_info (name, orig_path);
+		if (date != NULL &&
+		    (item == NULL || g_strcmp0 (date, item->deletion_date) >= 0)) {
+			if (item == NULL) {
+				item = g_new0 (TrashItem, 1);
+			}
+			g_free (item->name);
+			g_free (item->deletion_date);
+			item->name = name;
+			item->deletion_date = date;
+		} else {
+			g_free (date);
+			g_free (name);
+		}
+	}
+
+	g_free (orig_path);
+	g_free (basename);
+
+	return item;
+}
+
 static void
 trash_strings_func (NautilusFileUndoInfo *info,
 		    gchar **undo_label,
@@ -1058,6 +1507,9 @@ trash_redo_func_callback (GHashTable *debuting_uris,
 		g_hash_table_destroy (self->priv->trashed);
 
 		self->priv->trashed = new_trashed_files;
+
+		/* The files went to new trash items, undo looks them up again */
+		g_hash_table_remove_all (self->priv->trash_items);
 	}
 
 	file_undo_info_delete_callback (debuting_uris, user_cancel, user_data);
@@ -1080,6 +1532,21 @@ trash_redo_func (NautilusFileUndoInfo *info,
 	}
 }
 
+typedef struct {
+	/* item in the trash -> original location */
+	GHashTable *to_restore;
+	/* item in the home trash -> its .trashinfo file */
+	GHashTable *info_files;
+} TrashRestoreData;
+
+static void
+trash_restore_data_free (TrashRestoreData *data)
+{
+	g_hash_table_destroy (data->to_restore);
+	g_hash_table_destroy (data->info_files);
+	g_free (data);
+}
+
 static void
 trash_retrieve_files_to_restore_thread (GTask *task,
                                         gpointer source_object,
@@ -1088,13 +1555,75 @@ trash_retrieve_files_to_restore_thread (GTask *task,
 {
         NautilusFileUndoInfoTrash *self = NAUTILUS_FILE_UNDO_INFO_TRASH (source_object);
 	GFileEnumerator *enumerator;
-	GHashTable *to_restore;
+	TrashRestoreData *data;
+	GHashTable *to_restore, *not_found;
+	GHashTableIter iter;
+	gpointer key, value;
+	TrashItem *trash_item;
 	GFile *trash;
 	GError *error = NULL;
 
-	to_restore = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, 
-					    g_object_unref, g_object_unref);
+	data = g_new0 (TrashRestoreData, 1);
+	data->to_restore = to_restore =
+		g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+				       g_object_unref, g_object_unref);
+	data->info_files =
+		g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+				       g_object_unref, g_free);
+	not_found = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+
+	/* Restore straight from the home trash whatever is still where it
+	 * was recorded, or can be found by its name */
+	g_hash_table_iter_init (&iter, self->priv->trashed);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		GFile *origfile = key;
+		char *orig_path, *date;
+		gboolean found;
+
+		orig_path = g_file_get_path (origfile);
+		trash_item = g_hash_table_lookup (self->priv->trash_items, origfile);
+		found = FALSE;
+
+		if (orig_path != NULL && trash_item != NULL) {
+			date = read_home_trash_info (trash_item->name, orig_path);
+			found = g_strcmp0 (date, trash_item->deletion_date) == 0;
+			g_free (date);
+		}
+
+		if (orig_path != NULL && !found) {
+			trash_item = find_home_trash_item (origfile);
+			if (trash_item != NULL) {
+				g_hash_table_replace (self->priv->trash_items,
+						      g_object_ref (origfile), trash_item);
+				found = TRUE;
+			}
+		}
+
+		if (found) {
+			char *path;
+			GFile *item;
+
+			path = get_home_trash_path ("files", trash_item->name, "");
+			item = g_file_new_for_path (path);
+			g_free (path);
+
+			g_hash_table_insert (data->info_files, g_object_ref (item),
+					     get_home_trash_path ("info", trash_item->name, ".trashinfo"));
+			g_hash_table_insert (to_restore, item, g_object_ref (origfile));
+		} else {
+			g_hash_table_add (not_found, origfile);
+		}
 
+		g_free (orig_path);
+	}
+
+	if (g_hash_table_size (not_found) == 0) {
+		g_hash_table_destroy (not_found);
+		g_task_return_pointer (task, data, (GDestroyNotify) trash_restore_data_free);
+		return;
+	}
+
+	/* The rest has to be looked for in the whole trash */
 	trash = g_file_new_for_uri ("trash:///");
 
 	enumerator = g_file_enumerate_children (trash,
@@ -1117,7 +1646,10 @@ trash_retrieve_files_to_restore_thread (GTask *task,
 			origpath = g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
 			origfile = g_file_new_for_path (origpath);
 
-			lookupvalue = g_hash_table_lookup (self->priv->trashed, origfile);
+			lookupvalue = NULL;
+			if (g_hash_table_contains (not_found, origfile)) {
+				lookupvalue = g_hash_table_lookup (self->priv->trashed, origfile);
+			}
 
 			if (lookupvalue) {
 				GDateTime *date;
@@ -1144,12 +1676,13 @@ trash_retrieve_files_to_restore_thread (GTask *task,
 		g_object_unref (enumerator);
 	}
 	g_object_unref (trash);
+	g_hash_table_destroy (not_found);
 
 	if (error != NULL) {
                 g_task_return_error (task, error);
-		g_hash_table_destroy (to_restore);
+		trash_restore_data_free (data);
 	} else {
-                g_task_return_pointer (task, to_restore, NULL);
+                g_task_return_pointer (task, data, (GDestroyNotify) trash_restore_data_free);
 	}
 }
 
@@ -1173,15 +1706,18 @@ trash_retrieve_files_ready (GObject *source,
 			    gpointer user_data)
 {
 	NautilusFileUndoInfoTrash *self = NAUTILUS_FILE_UNDO_INFO_TRASH (source);
+	TrashRestoreData *data;
 	GHashTable *files_to_restore;
 	GError *error = NULL;
 
-        files_to_restore = g_task_propagate_pointer (G_TASK (res), &error);
+        data = g_task_propagate_pointer (G_TASK (res), &error);
+	files_to_restore = data != NULL ? data->to_restore : NULL;
 
 	if (error == NULL && g_hash_table_size (files_to_restore) > 0) {
 		GList *gfiles_in_trash, *l;
 		GFile *item;
 		GFile *dest;
+		const char *info_path;
 
 		gfiles_in_trash = g_hash_table_get_keys (files_to_restore);
 
@@ -1189,7 +1725,14 @@ trash_retrieve_files_ready (GObject *source,
 			item = l->data;
 			dest = g_hash_table_lookup (files_to_restore, item);
 
-			g_file_move (item, dest, G_FILE_COPY_NOFOLLOW_SYMLINKS, NULL, NULL, NULL, NULL);
+			if (g_file_move (item, dest, G_FILE_COPY_NOFOLLOW_SYMLINKS, NULL, NULL, NULL, NULL)) {
+				/* Items taken from the home trash directly leave
+				 * their .trashinfo behind */
+				info_path = g_hash_table_lookup (data->info_files, item);
+				if (info_path != NULL) {
+					g_unlink (info_path);
+				}
+			}
 		}
 
 		g_list_free (gfiles_in_trash);
@@ -1200,8 +1743,8 @@ trash_retrieve_files_ready (GObject *source,
 		file_undo_info_transfer_callback (NULL, FALSE, self);
 	}
 
-	if (files_to_restore != NULL) {
-		g_hash_table_destroy (files_to_restore);
+	if (data != NULL) {
+		trash_restore_data_free (data);
 	}
 
 	g_clear_error (&error);
@@ -1224,6 +1767,9 @@ nautilus_file_undo_info_trash_init (NautilusFileUndoInfoTrash *self)
 	self->priv->trashed =
 		g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, 
 				       g_object_unref, NULL);
+	self->priv->trash_items =
+		g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+				       g_object_unref, (GDestroyNotify) trash_item_free);
 }
 
 static void
@@ -1231,6 +1777,7 @@ nautilus_file_undo_info_trash_finalize (GObject *obj)
 {
 	NautilusFileUndoInfoTrash *self = NAUTILUS_FILE_UNDO_INFO_TRASH (obj);
 	g_hash_table_destroy (self->priv->trashed);
+	g_hash_table_destroy (self->priv->trash_items);
 
 	G_OBJECT_CLASS (nautilus_file_undo_info_trash_parent_class)->finalize (obj);
 }
@@ -1265,11 +1812,18 @@ nautilus_file_undo_info_trash_add_file (NautilusFileUndoInfoTrash *self,
 {
 	GTimeVal current_time;
 	gsize orig_trash_time;
+	TrashItem *trash_item;
 
 	g_get_current_time (&current_time);
 	orig_trash_time = current_time.tv_sec;
 
 	g_hash_table_insert (self->priv->trashed, g_object_ref (file), GSIZE_TO_POINTER (orig_trash_time));
+
+	/* Called right after trashing @file, so this is where it went */
+	trash_item = find_home_trash_item (file);
+	if (trash_item != NULL) {
+		g_hash_table_replace (self->priv->trash_items, g_object_ref (file), trash_item);
+	}
 }
 
 GList *
@@ -1281,9 +1835,12 @@ nautilus_file_undo_info_trash_get_files (NautilusFileUndoInfoTrash *self)
 /* recursive permissions */
 G_DEFINE_TYPE (NautilusFileUndoInfoRecPermissions, nautilus_file_undo_info_rec_permissions, NAUTILUS_TYPE_FILE_UNDO_INFO)
 
+/* The original modes are kept grouped by value: most of a tree shares a
+ * handful of modes, so each one is stored once with the URIs that had it.
+ */
 struct _NautilusFileUndoInfoRecPermissionsDetails {
 	GFile *dest_dir;
-	GHashTable *original_permissions;
+	GHashTable *original_permissions; /* mode -> GPtrArray of URIs */
 	guint32 dir_mask;
 	guint32 dir_permissions;
 	guint32 file_mask;
@@ -1342,24 +1899,27 @@ rec_permissions_undo_func (NautilusFileUndoInfo *info,
 	NautilusFileUndoInfoRecPermissions *self = NAUTILUS_FILE_UNDO_INFO_REC_PERMISSIONS (info);
 
 	if (g_hash_table_size (self->priv->original_permissions) > 0) {
-		GList *gfiles_list;
+		GHashTableIter iter;
+		gpointer key, value;
+		GPtrArray *uris;
 		guint32 perm;
-		GList *l;
 		GFile *dest;
-		char *item;
-
-		gfiles_list = g_hash_table_get_keys (self->priv->original_permissions);
-		for (l = gfiles_list; l != NULL; l = l->next) {
-			item = l->data;
-			perm = GPOINTER_TO_UINT (g_hash_table_lookup (self->priv->original_permissions, item));
-			dest = g_file_new_for_uri (item);
-			g_file_set_attribute_uint32 (dest,
-						     G_FILE_ATTRIBUTE_UNIX_MODE,
-						     perm, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
-			g_object_unref (dest);
+		guint i;
+
+		g_hash_table_iter_init (&iter, self->priv->original_permissions);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			perm = GPOINTER_TO_UINT (key);
+			uris = value;
+
+			for (i = 0; i < uris->len; i++) {
+				dest = g_file_new_for_uri (g_ptr_array_index (uris, i));
+				g_file_set_attribute_uint32 (dest,
+							     G_FILE_ATTRIBUTE_UNIX_MODE,
+							     perm, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+				g_object_unref (dest);
+			}
 		}
 
-		g_list_free (gfiles_list);
 		/* Here we must do what's necessary for the callback */
 		file_undo_info_transfer_callback (NULL, TRUE, self);
 	}
@@ -1372,7 +1932,7 @@ nautilus_file_undo_info_rec_permissions_init (NautilusFileUndoInfoRecPermissions
 						  NautilusFileUndoInfoRecPermissionsDetails);
 
 	self->priv->original_permissions =
-		g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_ptr_array_unref);
 }
 
 static void
@@ -1424,13 +1984,46 @@ nautilus_file_undo_info_rec_permissions_new (GFile   *dest,
 	return NAUTILUS_FILE_UNDO_INFO (retval);
 }
 
+static GPtrArray *
+rec_permissions_get_group (NautilusFileUndoInfoRecPermissions *self,
+			   guint32                             permission)
+{
+	GPtrArray *uris;
+
+	uris = g_hash_table_lookup (self->priv->original_permissions,
+				    GUINT_TO_POINTER (permission));
+	if (uris == NULL) {
+		uris = g_ptr_array_new_with_free_func (g_free);
+		g_hash_table_insert (self->priv->original_permissions,
+				     GUINT_TO_POINTER (permission), uris);
+	}
+
+	return uris;
+}
+
 void
 nautilus_file_undo_info_rec_permissions_add_file (NautilusFileUndoInfoRecPermissions *self,
 						  GFile                              *file,
 						  guint32                             permission)
 {
-	gchar *original_uri = g_file_get_uri (file);
-	g_hash_table_insert (self->priv->original_permissions, original_uri, GUINT_TO_POINTER (permission));
+	g_ptr_array_add (rec_permissions_get_group (self, permission),
+			 g_file_get_uri (file));
+}
+
+/* Takes over the strings in @uris, the caller only frees the array itself. */
+void
+nautilus_file_undo_info_rec_permissions_add_uris (NautilusFileUndoInfoRecPermissions *self,
+						  guint32                             permission,
+						  gchar                             **uris,
+						  guint                               n_uris)
+{
+	GPtrArray *group;
+	guint i;
+
+	group = rec_permissions_get_group (self, permission);
+	for (i = 0; i < n_uris; i++) {
+		g_ptr_array_add (group, uris[i]);
+	}
 }
 
 /* single file change permissions */
@@ -126,6 +126,9 @@ NautilusFileUndoInfo *nautilus_file_undo_info_ext_new (NautilusFileUndoOp op_typ
 void nautilus_file_undo_info_ext_add_origin_target_pair (NautilusFileUndoInfoExt *self,
 							 GFile                   *origin,
 							 GFile                   *target);
+void nautilus_file_undo_info_ext_add_origin_target_pairs (NautilusFileUndoInfoExt *self,
+							  GList                   *origins,
+							  GList                   *targets);
 
 /* create new file/folder */
 #define NAUTILUS_TYPE_FILE_UNDO_INFO_CREATE         (nautilus_file_undo_info_create_get_type ())
@@ -242,6 +245,10 @@ NautilusFileUndoInfo *nautilus_file_undo_info_rec_permissions_new (GFile   *dest
 void nautilus_file_undo_info_rec_permissions_add_file (NautilusFileUndoInfoRecPermissions *self,
 						       GFile                              *file,
 						       guint32                             permission);
+void nautilus_file_undo_info_rec_permissions_add_uris (NautilusFileUndoInfoRecPermissions *self,
+						       guint32                             permission,
+						       gchar                             **uris,
+						       guint                               n_uris);
 
 /* single file change permissions */
 #define NAUTILUS_TYPE_FILE_UNDO_INFO_PERMISSIONS         (nautilus_file_undo_info_permissions_get_type ())
@@ -33,6 +33,7 @@
 #include "nautilus-lib-self-check-functions.h"
 #include "nautilus-link.h"
 #include "nautilus-metadata.h"
+#include "nautilus-metadata-store.h"
 #include "nautilus-module.h"
 #include "nautilus-thumbnails.h"
 #include "nautilus-ui-utilities.h"
@@ -395,6 +396,95 @@ get_metadata_from_info (GFileInfo *info)
 	return metadata;
 }
 
+static void
+metadata_hash_remove (GHashTable *metadata,
+		      guint id)
+{
+	gpointer value;
+
+	value = g_hash_table_lookup (metadata, GUINT_TO_POINTER (id));
+	if (value != NULL) {
+		g_hash_table_remove (metadata, GUINT_TO_POINTER (id));
+		foreach_metadata_free (GUINT_TO_POINTER (id), value, NULL);
+	}
+}
+
+/* Applies the metadata attributes set in @info on top of @metadata,
+ * attributes of type G_FILE_ATTRIBUTE_TYPE_INVALID unset the key.
+ */
+static gboolean
+merge_metadata_from_info (GHashTable *metadata,
+			  GFileInfo *info)
+{
+	char **attrs;
+	guint id;
+	int i;
+	GFileAttributeType type;
+	gpointer value;
+	char *string_value;
+	char **list_value;
+	gboolean changed;
+
+	changed = FALSE;
+	attrs = g_file_info_list_attributes (info, "metadata");
+
+	for (i = 0; attrs[i] != NULL; i++) {
+		id = nautilus_metadata_get_id (attrs[i] + strlen ("metadata::"));
+		if (id == 0) {
+			continue;
+		}
+
+		if (!g_file_info_get_attribute_data (info, attrs[i],
+						     &type, &value, NULL)) {
+			continue;
+		}
+
+		string_value = g_hash_table_lookup (metadata, GUINT_TO_POINTER (id));
+		list_value = g_hash_table_lookup (metadata, GUINT_TO_POINTER (id | METADATA_ID_IS_LIST_MASK));
+
+		if (type == G_FILE_ATTRIBUTE_TYPE_STRING) {
+			if (list_value == NULL && string_value != NULL &&
+			    strcmp (string_value, (char *)value) == 0) {
+				continue;
+			}
+		} else if (type == G_FILE_ATTRIBUTE_TYPE_STRINGV) {
+			if (string_value == NULL && list_value != NULL &&
+			    eel_g_strv_equal (list_value, (char **)value)) {
+				continue;
+			}
+		} else if (string_value == NULL && list_value == NULL) {
+			continue;
+		}
+
+		metadata_hash_remove (metadata, id);
+		metadata_hash_remove (metadata, id | METADATA_ID_IS_LIST_MASK);
+
+		if (type == G_FILE_ATTRIBUTE_TYPE_STRING) {
+			g_hash_table_insert (metadata, GUINT_TO_POINTER (id),
+					     g_strdup ((char *)value));
+		} else if (type == G_FILE_ATTRIBUTE_TYPE_STRINGV) {
+			g_hash_table_insert (metadata, GUINT_TO_POINTER (id | METADATA_ID_IS_LIST_MASK),
+					     g_strdupv ((char **)value));
+		}
+		changed = TRUE;
+	}
+
+	g_strfreev (attrs);
+
+	return changed;
+}
+
+gboolean
+nautilus_file_merge_metadata_from_info (NautilusFile *file,
+					GFileInfo *info)
+{
+	if (file->details->metadata == NULL) {
+		file->details->metadata = g_hash_table_new (NULL, NULL);
+	}
+
+	return merge_metadata_from_info (file->details->metadata, info);
+}
+
 gboolean
 nautilus_file_update_metadata_from_info (NautilusFile *file,
 					 GFileInfo *info)
@@ -403,8 +493,16 @@ nautilus_file_update_metadata_from_info (NautilusFile *file,
 
 	if (g_file_info_has_namespace (info, "metadata")) {
 		GHashTable *metadata;
+		GFileInfo *pending;
 
 		metadata = get_metadata_from_info (info);
+
+		/* Don't let what's on disk override writes still queued */
+		pending = nautilus_metadata_store_get_pending (file);
+		if (pending != NULL) {
+			merge_metadata_from_info (metadata, pending);
+		}
+
 		if (!metadata_hash_equal (metadata,
 					  file->details->metadata)) {
 			changed = TRUE;
@@ -7523,6 +7621,16 @@ nautilus_file_is_thumbnailing (NautilusFile *file)
 	return file->details->is_thumbnailing;
 }
 
+void
+nautilus_file_prioritize_extension_info (NautilusFile *file)
+{
+	g_return_if_fail (NAUTILUS_IS_FILE (file));
+
+	if (file->details->directory != NULL) {
+		nautilus_directory_prioritize_file_in_work_queue (file->details->directory, file);
+	}
+}
+
 void
 nautilus_file_set_is_thumbnailing (NautilusFile *file,
 				   gboolean is_thumbnailing)
@@ -470,6 +470,9 @@ gboolean                nautilus_file_opens_in_view                     (Nautilu
 /* Thumbnailing handling */
 gboolean                nautilus_file_is_thumbnailing                   (NautilusFile                   *file);
 
+/* Get extension info for a file the user can see before the others */
+void                    nautilus_file_prioritize_extension_info         (NautilusFile                   *file);
+
 /* Convenience functions for dealing with a list of NautilusFile objects that each have a ref.
  * These are just convenient names for functions that work on lists of GtkObject *.
  */
@@ -187,6 +187,7 @@ struct NautilusFilesViewDetails
         guint update_context_menus_timeout_id;
         guint update_status_idle_id;
         guint reveal_selection_idle_id;
+        guint deferred_extensions_menus_idle_id;
 
         guint display_pending_source_id;
         guint changes_timeout_id;
@@ -236,6 +237,10 @@ struct NautilusFilesViewDetails
 
         gboolean selection_was_removed;
 
+        /* The selection, built at most once per change; see peek_selection() */
+        GList *cached_selection;
+        gboolean cached_selection_valid;
+
         gboolean metadata_for_directory_as_file_pending;
         gboolean metadata_for_files_in_directory_pending;
 
@@ -296,6 +301,7 @@ static void     schedule_update_context_menus                  (NautilusFilesVie
 static void     remove_update_context_menus_timeout_callback   (NautilusFilesView      *view);
 static void     schedule_update_status                          (NautilusFilesView      *view);
 static void     remove_update_status_idle_callback             (NautilusFilesView *view);
+static void     remove_deferred_extensions_menus_idle          (NautilusFilesView *view);
 static void     reset_update_interval                          (NautilusFilesView      *view);
 static void     schedule_idle_display_of_pending_files         (NautilusFilesView      *view);
 static void     unschedule_display_of_pending_files            (NautilusFilesView      *view);
@@ -829,6 +835,54 @@ nautilus_files_view_get_selection (NautilusView *view)
         return NAUTILUS_FILES_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->get_selection (NAUTILUS_FILES_VIEW (view));
 }
 
+static void
+invalidate_cached_selection (NautilusFilesView *view)
+{
+        nautilus_file_list_free (view->details->cached_selection);
+        view->details->cached_selection = NULL;
+        view->details->cached_selection_valid = FALSE;
+}
+
+/* Returns the selection without copying it, for the handlers that
+ * update the menus and the status on every selection change. Building
+ * the selection is linear in the size of the folder, so it is done
+ * once per change. The list belongs to the view.
+ */
+static GList *
+peek_selection (NautilusFilesView *view)
+{
+        if (!view->details->cached_selection_valid) {
+                view->details->cached_selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
+                view->details->cached_selection_valid = TRUE;
+        }
+
+        return view->details->cached_selection;
+}
+
+static guint
+real_get_selection_count (NautilusFilesView *view)
+{
+        return g_list_length (peek_selection (view));
+}
+
+/**
+ * nautilus_files_view_get_selection_count:
+ *
+ * Get the number of selected items in this view, without building
+ * the selection when the subclass can avoid it.
+ * @view: NautilusFilesView whose selected items are of interest.
+ *
+ * Return value: the number of selected items.
+ *
+ **/
+guint
+nautilus_files_view_get_selection_count (NautilusFilesView *view)
+{
+        g_return_val_if_fail (NAUTILUS_IS_FILES_VIEW (view), 0);
+
+        return NAUTILUS_FILES_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->get_selection_count (view);
+}
+
 typedef struct {
         NautilusFile *file;
         NautilusFilesView *directory_view;
@@ -2773,6 +2827,7 @@ nautilus_files_view_destroy (GtkWidget *object)
 
         remove_update_context_menus_timeout_callback (view);
         remove_update_status_idle_callback (view);
+        remove_deferred_extensions_menus_idle (view);
 
         if (view->details->display_selection_idle_id != 0) {
                 g_source_remove (view->details->display_selection_idle_id);
@@ -2842,6 +2897,7 @@ nautilus_files_view_finalize (GObject *object)
 
         g_hash_table_destroy (view->details->non_ready_files);
         g_hash_table_destroy (view->details->pending_reveal);
+        invalidate_cached_selection (view);
 
         G_OBJECT_CLASS (nautilus_files_view_parent_class)->finalize (object);
 }
@@ -2874,7 +2930,7 @@ nautilus_files_view_display_selection_info (NautilusFilesView *view)
 
         g_return_if_fail (NAUTILUS_IS_FILES_VIEW (view));
 
-        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
+        selection = peek_selection (view);
 
         folder_item_count_known = TRUE;
         folder_count = 0;
@@ -2910,8 +2966,6 @@ nautilus_files_view_display_selection_info (NautilusFilesView *view)
                 }
         }
 
-        nautilus_file_list_free (selection);
-
         /* Break out cases for localization's sake. But note that there are still pieces
          * being assembled in a particular order, which may be a problem for some localizers.
          */
@@ -3098,7 +3152,6 @@ done_loading (NautilusFilesView *view,
               gboolean           all_files_seen)
 {
         GList *pending_selection;
-        GList *selection;
         gboolean do_reveal = FALSE;
 
         if (!view->details->loading) {
@@ -3115,10 +3168,10 @@ done_loading (NautilusFilesView *view,
                 reset_update_interval (view);
 
                 pending_selection = view->details->pending_selection;
-                selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
 
                 if (nautilus_view_is_searching (NAUTILUS_VIEW (view)) &&
-                    all_files_seen && !selection && !pending_selection) {
+                    all_files_seen && !pending_selection &&
+                    nautilus_files_view_get_selection_count (view) == 0) {
                         nautilus_files_view_select_first (view);
                         do_reveal = TRUE;
                 } else if (pending_selection != NULL && all_files_seen) {
@@ -3128,9 +3181,6 @@ done_loading (NautilusFilesView *view,
                         do_reveal = TRUE;
                 }
 
-                if (selection)
-                        g_list_free_full (selection, g_object_unref);
-
                 if (pending_selection)
                         g_list_free_full (pending_selection, g_object_unref);
 
@@ -3589,6 +3639,9 @@ process_old_files (NautilusFilesView *view)
                         gboolean should_show_file;
                         pending = node->data;
                         should_show_file = still_should_show_file (view, pending->file, pending->directory);
+                        if (!should_show_file) {
+                                invalidate_cached_selection (view);
+                        }
                         g_signal_emit (view,
                                        signals[should_show_file ? FILE_CHANGED : REMOVE_FILE], 0,
                                        pending->file, pending->directory);
@@ -3638,7 +3691,7 @@ display_pending_files (NautilusFilesView *view)
         process_new_files (view);
         process_old_files (view);
 
-        if (!nautilus_files_view_get_selection (NAUTILUS_VIEW (view)) &&
+        if (nautilus_files_view_get_selection_count (view) == 0 &&
             !view->details->pending_selection &&
             nautilus_view_is_searching (NAUTILUS_VIEW (view))) {
                 nautilus_files_view_select_first (view);
@@ -4213,14 +4266,44 @@ get_menu_icon_for_file (NautilusFile *file,
         return pixbuf;
 }
 
+/* Providers the watchdog demoted only get asked once the rest of the
+ * menu is up, see update_extensions_menus(). */
+static gboolean
+skip_menu_provider (gpointer provider,
+                    gboolean deferred)
+{
+        return nautilus_module_provider_is_demoted (provider, NAUTILUS_MODULE_INTERFACE_MENU) != deferred;
+}
+
+static gboolean
+has_deferred_menu_providers (void)
+{
+        GList *providers;
+        GList *l;
+        gboolean deferred;
+
+        providers = nautilus_module_get_extensions_for_type (NAUTILUS_TYPE_MENU_PROVIDER);
+        deferred = FALSE;
+
+        for (l = providers; l != NULL && !deferred; l = l->next) {
+                deferred = nautilus_module_provider_is_demoted (l->data, NAUTILUS_MODULE_INTERFACE_MENU);
+        }
+
+        nautilus_module_extension_list_free (providers);
+
+        return deferred;
+}
+
 static GList *
-get_extension_selection_menu_items (NautilusFilesView *view)
+get_extension_selection_menu_items (NautilusFilesView *view,
+                                    gboolean           deferred)
 {
         NautilusWindow *window;
         GList *items;
         GList *providers;
         GList *l;
         GList *selection;
+        gint64 start_time;
 
         window = nautilus_files_view_get_window (view);
         selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
@@ -4232,9 +4315,15 @@ get_extension_selection_menu_items (NautilusFilesView *view)
                 GList *file_items;
 
                 provider = NAUTILUS_MENU_PROVIDER (l->data);
+                if (skip_menu_provider (provider, deferred)) {
+                        continue;
+                }
+
+                start_time = g_get_monotonic_time ();
                 file_items = nautilus_menu_provider_get_file_items (provider,
                                                                     GTK_WIDGET (window),
                                                                     selection);
+                nautilus_module_record_call (provider, NAUTILUS_MODULE_INTERFACE_MENU, start_time);
                 items = g_list_concat (items, file_items);
         }
 
@@ -4244,12 +4333,14 @@ get_extension_selection_menu_items (NautilusFilesView *view)
 }
 
 static GList *
-get_extension_background_menu_items (NautilusFilesView *view)
+get_extension_background_menu_items (NautilusFilesView *view,
+                                     gboolean           deferred)
 {
         NautilusWindow *window;
         GList *items;
         GList *providers;
         GList *l;
+        gint64 start_time;
 
         window = nautilus_files_view_get_window (view);
         providers = nautilus_module_get_extensions_for_type (NAUTILUS_TYPE_MENU_PROVIDER);
@@ -4260,9 +4351,15 @@ get_extension_background_menu_items (NautilusFilesView *view)
                 GList *file_items;
 
                 provider = NAUTILUS_MENU_PROVIDER (l->data);
+                if (skip_menu_provider (provider, deferred)) {
+                        continue;
+                }
+
+                start_time = g_get_monotonic_time ();
                 file_items = nautilus_menu_provider_get_background_items (provider,
                                                                           GTK_WIDGET (window),
                                                                           view->details->directory_as_file);
+                nautilus_module_record_call (provider, NAUTILUS_MODULE_INTERFACE_MENU, start_time);
                 items = g_list_concat (items, file_items);
         }
 
@@ -4383,12 +4480,51 @@ add_extension_menu_items (NautilusFilesView *view,
         g_object_unref (menu);
 }
 
+static gboolean
+deferred_extensions_menus_idle_callback (gpointer data)
+{
+        NautilusFilesView *view;
+        GList *selection_items, *background_items;
+
+        view = NAUTILUS_FILES_VIEW (data);
+        view->details->deferred_extensions_menus_idle_id = 0;
+
+        selection_items = get_extension_selection_menu_items (view, TRUE);
+        if (selection_items != NULL) {
+                add_extension_menu_items (view,
+                                          "selection_deferred",
+                                          selection_items,
+                                          view->details->selection_menu);
+                nautilus_menu_item_list_free (selection_items);
+        }
+
+        background_items = get_extension_background_menu_items (view, TRUE);
+        if (background_items != NULL) {
+                add_extension_menu_items (view,
+                                          "background_deferred",
+                                          background_items,
+                                          view->details->background_menu);
+                nautilus_menu_item_list_free (background_items);
+        }
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+remove_deferred_extensions_menus_idle (NautilusFilesView *view)
+{
+        if (view->details->deferred_extensions_menus_idle_id != 0) {
+                g_source_remove (view->details->deferred_extensions_menus_idle_id);
+                view->details->deferred_extensions_menus_idle_id = 0;
+        }
+}
+
 static void
 update_extensions_menus (NautilusFilesView *view)
 {
         GList *selection_items, *background_items;
 
-        selection_items = get_extension_selection_menu_items (view);
+        selection_items = get_extension_selection_menu_items (view, FALSE);
         if (selection_items != NULL) {
                 add_extension_menu_items (view,
                                           "selection",
@@ -4397,7 +4533,7 @@ update_extensions_menus (NautilusFilesView *view)
                 nautilus_menu_item_list_free (selection_items);
         }
 
-        background_items = get_extension_background_menu_items (view);
+        background_items = get_extension_background_menu_items (view, FALSE);
         if (background_items != NULL) {
                 add_extension_menu_items (view,
                                           "background",
@@ -4405,6 +4541,13 @@ update_extensions_menus (NautilusFilesView *view)
                                           view->details->background_menu);
                 nautilus_menu_item_list_free (background_items);
         }
+
+        /* The menus were just rebuilt, so whatever was deferred before is gone */
+        remove_deferred_extensions_menus_idle (view);
+        if (has_deferred_menu_providers ()) {
+                view->details->deferred_extensions_menus_idle_id =
+                        g_idle_add (deferred_extensions_menus_idle_callback, view);
+        }
 }
 
 static char *
@@ -6249,7 +6392,7 @@ real_update_actions_state (NautilusFilesView *view)
 
         view_action_group = view->details->view_action_group;
 
-        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
+        selection = peek_selection (view);
         selection_count = g_list_length (selection);
         selection_contains_special_link = nautilus_files_view_special_link_in_selection (view, selection);
         selection_contains_desktop_or_home_dir = desktop_or_home_dir_in_selection (selection);
@@ -6314,10 +6457,6 @@ real_update_actions_state (NautilusFilesView *view)
                                              "new-folder");
         g_simple_action_set_enabled (G_SIMPLE_ACTION (action), can_create_files);
 
-
-        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
-        selection_count = g_list_length (selection);
-
         item_opens_in_view = selection_count != 0;
 
         for (l = selection; l != NULL; l = l->next) {
@@ -6574,7 +6713,7 @@ update_selection_menu (NautilusFilesView *view)
         gboolean show_detect_media;
         GDriveStartStopType start_stop_type;
 
-        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
+        selection = peek_selection (view);
         selection_count = g_list_length (selection);
 
         show_mount = (selection != NULL);
@@ -6989,10 +7128,16 @@ nautilus_files_view_notify_selection_changed (NautilusFilesView *view)
 
         g_return_if_fail (NAUTILUS_IS_FILES_VIEW (view));
 
-        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
-        window = nautilus_files_view_get_containing_window (view);
-        DEBUG_FILES (selection, "Selection changed in window %p", window);
-        nautilus_file_list_free (selection);
+        invalidate_cached_selection (view);
+
+        /* Building the selection can be costly in large folders,
+         * don't do it just to log it.
+         */
+        if (DEBUGGING) {
+                selection = peek_selection (view);
+                window = nautilus_files_view_get_containing_window (view);
+                DEBUG_FILES (selection, "Selection changed in window %p", window);
+        }
 
         view->details->selection_was_removed = FALSE;
 
@@ -7050,6 +7195,7 @@ load_directory (NautilusFilesView *view,
         nautilus_profile_start (NULL);
 
         nautilus_files_view_stop_loading (view);
+        invalidate_cached_selection (view);
         g_signal_emit (view, signals[CLEAR], 0);
 
         view->details->loading = TRUE;
@@ -8005,6 +8151,7 @@ nautilus_files_view_class_init (NautilusFilesViewClass *klass)
         klass->get_window = nautilus_files_view_get_window;
         klass->update_context_menus = real_update_context_menus;
         klass->update_actions_state = real_update_actions_state;
+        klass->get_selection_count = real_get_selection_count;
         klass->check_empty_states = real_check_empty_states;
 
         copied_files_atom = gdk_atom_intern ("x-special/gnome-copied-files", FALSE);
@@ -154,6 +154,12 @@ struct NautilusFilesViewClass {
          */
         GList *        (* get_selection_for_file_transfer)(NautilusFilesView *view);
 
+        /* get_selection_count is a function pointer for subclasses to
+         * override with a way to count the selected files without
+         * building the selection. The default counts the selection.
+         */
+        guint          (* get_selection_count)(NautilusFilesView *view);
+
         /* select_all is a function pointer that subclasses must override to
          * select all of the items in the view */
         void     (* select_all)              (NautilusFilesView *view);
@@ -297,6 +303,7 @@ void                nautilus_files_view_preview_files                    (Nautil
 void                nautilus_files_view_start_batching_selection_changes (NautilusFilesView *view);
 void                nautilus_files_view_stop_batching_selection_changes  (NautilusFilesView *view);
 void                nautilus_files_view_notify_selection_changed         (NautilusFilesView *view);
+guint               nautilus_files_view_get_selection_count              (NautilusFilesView *view);
 NautilusDirectory  *nautilus_files_view_get_model                        (NautilusFilesView *view);
 NautilusFile       *nautilus_files_view_get_directory_as_file            (NautilusFilesView *view);
 void                nautilus_files_view_pop_up_background_context_menu   (NautilusFilesView *view,
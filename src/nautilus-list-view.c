@@ -2254,6 +2254,12 @@ nautilus_list_view_get_selection (NautilusFilesView *view)
 	return g_list_reverse (list);
 }
 
+static guint
+nautilus_list_view_get_selection_count (NautilusFilesView *view)
+{
+	return gtk_tree_selection_count_selected_rows (gtk_tree_view_get_selection (NAUTILUS_LIST_VIEW (view)->details->tree_view));
+}
+
 static void
 nautilus_list_view_get_selection_for_file_transfer_foreach_func (GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer data)
 {
@@ -3132,6 +3138,7 @@ nautilus_list_view_class_init (NautilusListViewClass *class)
 	nautilus_files_view_class->get_backing_uri = nautilus_list_view_get_backing_uri;
 	nautilus_files_view_class->get_selection = nautilus_list_view_get_selection;
 	nautilus_files_view_class->get_selection_for_file_transfer = nautilus_list_view_get_selection_for_file_transfer;
+	nautilus_files_view_class->get_selection_count = nautilus_list_view_get_selection_count;
 	nautilus_files_view_class->is_empty = nautilus_list_view_is_empty;
 	nautilus_files_view_class->remove_file = nautilus_list_view_remove_file;
 	nautilus_files_view_class->restore_default_zoom_level = nautilus_list_view_restore_default_zoom_level;
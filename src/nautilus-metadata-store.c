@@ -0,0 +1,352 @@
+/*
+ * Nautilus
+ *
+ * Nautilus is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Nautilus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; see the file COPYING.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "nautilus-metadata-store.h"
+
+#include "nautilus-file-private.h"
+
+/* Things like laying out icons or resizing columns set metadata on many
+ * files in a row, often the same keys over and over. Writing each of
+ * them out as it comes, and re-reading the whole file info after every
+ * write, kept the metadata daemon and the views busy for nothing.
+ */
+#define METADATA_WRITE_DELAY_MSEC 500
+
+typedef struct {
+	NautilusFile *file;
+	GFileInfo *info;
+	/* Bumped on every change, to tell if a finished write is still current */
+	guint serial;
+	gboolean writing;
+} PendingMetadata;
+
+typedef struct {
+	NautilusFile *file;
+	guint serial;
+} MetadataWrite;
+
+/* NautilusFile -> PendingMetadata */
+static GHashTable *pending_metadata = NULL;
+static guint flush_timeout_id = 0;
+
+/* Metadata is stored per folder, so folders are written out one at a
+ * time: the next one in line starts when the last write of the previous
+ * one finishes. */
+static GQueue folders_to_write = G_QUEUE_INIT;
+static int writes_in_flight = 0;
+
+static void schedule_flush (void);
+static void write_next_folder (void);
+
+static void
+pending_metadata_free (PendingMetadata *pending)
+{
+	nautilus_file_unref (pending->file);
+	g_object_unref (pending->info);
+	g_slice_free (PendingMetadata, pending);
+}
+
+static PendingMetadata *
+get_pending_metadata (NautilusFile *file,
+		      gboolean create)
+{
+	PendingMetadata *pending;
+
+	if (pending_metadata == NULL) {
+		if (!create) {
+			return NULL;
+		}
+		pending_metadata = g_hash_table_new_full (NULL, NULL, NULL,
+							  (GDestroyNotify) pending_metadata_free);
+	}
+
+	pending = g_hash_table_lookup (pending_metadata, file);
+	if (pending == NULL && create) {
+		pending = g_slice_new0 (PendingMetadata);
+		pending->file = nautilus_file_ref (file);
+		pending->info = g_file_info_new ();
+		g_hash_table_insert (pending_metadata, file, pending);
+	}
+
+	return pending;
+}
+
+static void
+metadata_changed (NautilusFile *file,
+		  PendingMetadata *pending)
+{
+	pending->serial++;
+
+	if (nautilus_file_merge_metadata_from_info (file, pending->info)) {
+		nautilus_file_changed (file);
+	}
+
+	schedule_flush ();
+}
+
+void
+nautilus_metadata_store_set (NautilusFile *file,
+			     const char *key,
+			     const char *value)
+{
+	PendingMetadata *pending;
+	char *gio_key;
+
+	pending = get_pending_metadata (file, TRUE);
+
+	gio_key = g_strconcat ("metadata::", key, NULL);
+	if (value != NULL) {
+		g_file_info_set_attribute_string (pending->info, gio_key, value);
+	} else {
+		/* Unset the key */
+		g_file_info_set_attribute (pending->info, gio_key,
+					   G_FILE_ATTRIBUTE_TYPE_INVALID,
+					   NULL);
+	}
+	g_free (gio_key);
+
+	metadata_changed (file, pending);
+}
+
+void
+nautilus_metadata_store_set_list (NautilusFile *file,
+				  const char *key,
+				  char **value)
+{
+	PendingMetadata *pending;
+	char *gio_key;
+
+	pending = get_pending_metadata (file, TRUE);
+
+	gio_key = g_strconcat ("metadata::", key, NULL);
+	g_file_info_set_attribute_stringv (pending->info, gio_key, value);
+	g_free (gio_key);
+
+	metadata_changed (file, pending);
+}
+
+GFileInfo *
+nautilus_metadata_store_get_pending (NautilusFile *file)
+{
+	PendingMetadata *pending;
+
+	pending = get_pending_metadata (file, FALSE);
+
+	return pending != NULL ? pending->info : NULL;
+}
+
+static void
+reload_metadata_callback (GObject *source_object,
+			  GAsyncResult *res,
+			  gpointer callback_data)
+{
+	NautilusFile *file;
+	GFileInfo *info;
+
+	file = callback_data;
+
+	info = g_file_query_info_finish (G_FILE (source_object), res, NULL);
+	if (info != NULL) {
+		if (nautilus_file_update_metadata_from_info (file, info)) {
+			nautilus_file_changed (file);
+		}
+		g_object_unref (info);
+	}
+
+	nautilus_file_unref (file);
+}
+
+static void
+metadata_written_callback (GObject *source_object,
+			   GAsyncResult *result,
+			   gpointer callback_data)
+{
+	MetadataWrite *write;
+	PendingMetadata *pending;
+	GError *error;
+	gboolean res;
+
+	write = callback_data;
+
+	error = NULL;
+	res = g_file_set_attributes_finish (G_FILE (source_object),
+					    result,
+					    NULL,
+					    &error);
+
+	pending = get_pending_metadata (write->file, FALSE);
+	if (pending != NULL) {
+		pending->writing = FALSE;
+
+		if (pending->serial == write->serial) {
+			g_hash_table_remove (pending_metadata, write->file);
+		} else {
+			/* Changed again while being written */
+			schedule_flush ();
+		}
+	}
+
+	if (!res) {
+		/* What we have in memory is wrong then, get it back from disk */
+		g_file_query_info_async (G_FILE (source_object),
+					 "metadata::*",
+					 0,
+					 G_PRIORITY_DEFAULT,
+					 NULL,
+					 reload_metadata_callback,
+					 nautilus_file_ref (write->file));
+		g_error_free (error);
+	}
+
+	nautilus_file_unref (write->file);
+	g_slice_free (MetadataWrite, write);
+
+	writes_in_flight--;
+	if (writes_in_flight == 0) {
+		write_next_folder ();
+	}
+}
+
+static void
+write_pending_metadata (PendingMetadata *pending)
+{
+	MetadataWrite *write;
+	GFile *location;
+
+	write = g_slice_new0 (MetadataWrite);
+	write->file = nautilus_file_ref (pending->file);
+	write->serial = pending->serial;
+	pending->writing = TRUE;
+	writes_in_flight++;
+
+	location = nautilus_file_get_location (pending->file);
+	g_file_set_attributes_async (location,
+				     pending->info,
+				     0,
+				     G_PRIORITY_DEFAULT,
+				     NULL,
+				     metadata_written_callback,
+				     write);
+	g_object_unref (location);
+}
+
+static void
+write_next_folder (void)
+{
+	NautilusDirectory *directory;
+	GHashTableIter iter;
+	gpointer value;
+	PendingMetadata *pending;
+
+	while (writes_in_flight == 0 &&
+	       (directory = g_queue_pop_head (&folders_to_write)) != NULL) {
+		if (pending_metadata != NULL) {
+			g_hash_table_iter_init (&iter, pending_metadata);
+			while (g_hash_table_iter_next (&iter, NULL, &value)) {
+				pending = value;
+				if (!pending->writing &&
+				    pending->file->details->directory == directory) {
+					write_pending_metadata (pending);
+				}
+			}
+		}
+
+		nautilus_directory_unref (directory);
+	}
+}
+
+static gboolean
+flush_timeout_callback (gpointer data)
+{
+	GHashTableIter iter;
+	gpointer value;
+	PendingMetadata *pending;
+	NautilusDirectory *directory;
+
+	flush_timeout_id = 0;
+
+	if (pending_metadata == NULL) {
+		return G_SOURCE_REMOVE;
+	}
+
+	g_hash_table_iter_init (&iter, pending_metadata);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		pending = value;
+		if (pending->writing) {
+			continue;
+		}
+
+		directory = pending->file->details->directory;
+		if (g_queue_find (&folders_to_write, directory) == NULL) {
+			g_queue_push_tail (&folders_to_write,
+					   nautilus_directory_ref (directory));
+		}
+	}
+
+	write_next_folder ();
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_flush (void)
+{
+	if (flush_timeout_id != 0) {
+		return;
+	}
+
+	flush_timeout_id = g_timeout_add (METADATA_WRITE_DELAY_MSEC,
+					  flush_timeout_callback, NULL);
+}
+
+void
+nautilus_metadata_store_flush (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	PendingMetadata *pending;
+	GFile *location;
+
+	if (flush_timeout_id != 0) {
+		g_source_remove (flush_timeout_id);
+		flush_timeout_id = 0;
+	}
+
+	while (!g_queue_is_empty (&folders_to_write)) {
+		nautilus_directory_unref (g_queue_pop_head (&folders_to_write));
+	}
+
+	if (pending_metadata == NULL) {
+		return;
+	}
+
+	g_hash_table_iter_init (&iter, pending_metadata);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		pending = value;
+
+		location = nautilus_file_get_location (pending->file);
+		g_file_set_attributes_from_info (location, pending->info, 0, NULL, NULL);
+		g_object_unref (location);
+	}
+
+	/* Writes still in flight find nothing to clean up when they finish */
+	g_hash_table_remove_all (pending_metadata);
+}
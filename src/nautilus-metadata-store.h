@@ -0,0 +1,43 @@
+/*
+ * Nautilus
+ *
+ * Nautilus is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Nautilus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; see the file COPYING.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __NAUTILUS_METADATA_STORE_H__
+#define __NAUTILUS_METADATA_STORE_H__
+
+#include <gio/gio.h>
+
+#include "nautilus-file.h"
+
+/* Metadata writes are applied to the file in memory right away and
+ * written out folder by folder once they settle down.
+ */
+void       nautilus_metadata_store_set         (NautilusFile *file,
+						const char   *key,
+						const char   *value);
+void       nautilus_metadata_store_set_list    (NautilusFile *file,
+						const char   *key,
+						char        **value);
+
+/* Values not written out yet for @file, or NULL */
+GFileInfo *nautilus_metadata_store_get_pending (NautilusFile *file);
+
+/* Writes out everything pending, synchronously */
+void       nautilus_metadata_store_flush       (void);
+
+#endif /* __NAUTILUS_METADATA_STORE_H__ */
@@ -26,6 +26,14 @@
 #include <eel/eel-debug.h>
 #include <gmodule.h>
 
+#define DEBUG_FLAG NAUTILUS_DEBUG_EXTENSIONS
+#include "nautilus-debug.h"
+
+/* Calls over the budget set in NAUTILUS_EXTENSION_BUDGET (in ms) count as
+ * strikes; after this many the provider is demoted for that interface and
+ * callers run it deferred instead of right away. */
+#define WATCHDOG_STRIKES 3
+
 #define NAUTILUS_TYPE_MODULE    	(nautilus_module_get_type ())
 #define NAUTILUS_MODULE(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), NAUTILUS_TYPE_MODULE, NautilusModule))
 #define NAUTILUS_MODULE_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), NAUTILUS_TYPE_MODULE, NautilusModule))
@@ -56,6 +64,34 @@ struct _NautilusModuleClass {
 
 static GList *module_objects = NULL;
 
+typedef struct {
+	guint calls;
+	gint64 total_usec;
+	gint64 max_usec;
+	guint strikes;
+	gboolean demoted;
+} InterfaceStats;
+
+typedef struct {
+	char *module_name;
+	char *type_name;
+	InterfaceStats interfaces[NAUTILUS_MODULE_N_INTERFACES];
+} ProviderStats;
+
+static const char *interface_names[NAUTILUS_MODULE_N_INTERFACES] = {
+	"MenuProvider",
+	"InfoProvider",
+	"ColumnProvider",
+	"PropertyPageProvider",
+	"LocationWidgetProvider"
+};
+
+/* provider object -> ProviderStats */
+static GHashTable *provider_stats = NULL;
+/* The module whose types are being added, NULL for built-in ones */
+static NautilusModule *loading_module = NULL;
+static gint64 watchdog_budget_usec = 0;
+
 static GType nautilus_module_get_type (void);
 
 G_DEFINE_TYPE (NautilusModule, nautilus_module, G_TYPE_TYPE_MODULE);
@@ -157,10 +193,22 @@ nautilus_module_class_init (NautilusModuleClass *class)
 	G_TYPE_MODULE_CLASS (class)->unload = nautilus_module_unload;
 }
 
+static void
+provider_stats_free (ProviderStats *stats)
+{
+	g_free (stats->module_name);
+	g_free (stats->type_name);
+	g_slice_free (ProviderStats, stats);
+}
+
 static void
 module_object_weak_notify (gpointer user_data, GObject *object)
 {
 	module_objects = g_list_remove (module_objects, object);
+
+	if (provider_stats != NULL) {
+		g_hash_table_remove (provider_stats, object);
+	}
 }
 
 static void
@@ -172,12 +220,14 @@ add_module_objects (NautilusModule *module)
 	
 	module->list_types (&types, &num_types);
 	
+	loading_module = module;
 	for (i = 0; i < num_types; i++) {
 		if (types[i] == 0) { /* Work around broken extensions */
 			break;
 		}
 		nautilus_module_add_type (types[i]);
 	}
+	loading_module = NULL;
 }
 
 static NautilusModule *
@@ -228,6 +278,8 @@ static void
 free_module_objects (void)
 {
 	GList *l, *next;
+
+	nautilus_module_debug_statistics ();
 	
 	for (l = module_objects; l != NULL; l = next) {
 		next = l->next;
@@ -243,7 +295,14 @@ nautilus_module_setup (void)
 	static gboolean initialized = FALSE;
 
 	if (!initialized) {
+		const char *budget;
+
 		initialized = TRUE;
+
+		budget = g_getenv ("NAUTILUS_EXTENSION_BUDGET");
+		if (budget != NULL) {
+			watchdog_budget_usec = g_ascii_strtoll (budget, NULL, 10) * 1000;
+		}
 		
 		load_module_dir (NAUTILUS_EXTENSIONDIR);
 
@@ -284,6 +343,7 @@ void
 nautilus_module_add_type (GType type)
 {
 	GObject *object;
+	ProviderStats *stats;
 	
 	object = g_object_new (type, NULL);
 	g_object_weak_ref (object, 
@@ -291,4 +351,141 @@ nautilus_module_add_type (GType type)
 			   NULL);
 
 	module_objects = g_list_prepend (module_objects, object);
+
+	if (provider_stats == NULL) {
+		provider_stats = g_hash_table_new_full (NULL, NULL, NULL,
+							(GDestroyNotify) provider_stats_free);
+	}
+
+	stats = g_slice_new0 (ProviderStats);
+	stats->type_name = g_strdup (g_type_name (type));
+	if (loading_module != NULL) {
+		stats->module_name = g_path_get_basename (loading_module->path);
+	} else {
+		stats->module_name = g_strdup ("nautilus");
+	}
+	g_hash_table_insert (provider_stats, object, stats);
+}
+
+void
+nautilus_module_record_call (gpointer                provider,
+			     NautilusModuleInterface iface,
+			     gint64                  start_time)
+{
+	ProviderStats *stats;
+	InterfaceStats *iface_stats;
+	gint64 elapsed;
+
+	if (provider_stats == NULL ||
+	    (stats = g_hash_table_lookup (provider_stats, provider)) == NULL) {
+		return;
+	}
+
+	elapsed = g_get_monotonic_time () - start_time;
+
+	iface_stats = &stats->interfaces[iface];
+	iface_stats->calls++;
+	iface_stats->total_usec += elapsed;
+	iface_stats->max_usec = MAX (iface_stats->max_usec, elapsed);
+
+	if (watchdog_budget_usec > 0 && elapsed > watchdog_budget_usec) {
+		DEBUG ("%s (%s) %s call took %" G_GINT64_FORMAT " ms",
+		       stats->type_name, stats->module_name,
+		       interface_names[iface], elapsed / 1000);
+
+		if (!iface_stats->demoted &&
+		    ++iface_stats->strikes >= WATCHDOG_STRIKES) {
+			iface_stats->demoted = TRUE;
+			DEBUG ("Demoting %s (%s) as %s, it keeps going over the %" G_GINT64_FORMAT " ms budget",
+			       stats->type_name, stats->module_name,
+			       interface_names[iface], watchdog_budget_usec / 1000);
+		}
+	}
+}
+
+gboolean
+nautilus_module_provider_is_demoted (gpointer                provider,
+				     NautilusModuleInterface iface)
+{
+	ProviderStats *stats;
+
+	if (provider_stats == NULL ||
+	    (stats = g_hash_table_lookup (provider_stats, provider)) == NULL) {
+		return FALSE;
+	}
+
+	return stats->interfaces[iface].demoted;
+}
+
+/* One (module, type, interface, calls, total usec, max usec, demoted)
+ * entry for every interface a provider has been called through. */
+GVariant *
+nautilus_module_get_statistics (void)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	gpointer value;
+	ProviderStats *stats;
+	InterfaceStats *iface_stats;
+	int i;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssstttb)"));
+
+	if (provider_stats != NULL) {
+		g_hash_table_iter_init (&iter, provider_stats);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			stats = value;
+
+			for (i = 0; i < NAUTILUS_MODULE_N_INTERFACES; i++) {
+				iface_stats = &stats->interfaces[i];
+				if (iface_stats->calls == 0) {
+					continue;
+				}
+
+				g_variant_builder_add (&builder, "(ssstttb)",
+						       stats->module_name,
+						       stats->type_name,
+						       interface_names[i],
+						       (guint64) iface_stats->calls,
+						       (guint64) iface_stats->total_usec,
+						       (guint64) iface_stats->max_usec,
+						       iface_stats->demoted);
+			}
+		}
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+void
+nautilus_module_debug_statistics (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	ProviderStats *stats;
+	InterfaceStats *iface_stats;
+	int i;
+
+	if (provider_stats == NULL) {
+		return;
+	}
+
+	g_hash_table_iter_init (&iter, provider_stats);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		stats = value;
+
+		for (i = 0; i < NAUTILUS_MODULE_N_INTERFACES; i++) {
+			iface_stats = &stats->interfaces[i];
+			if (iface_stats->calls == 0) {
+				continue;
+			}
+
+			DEBUG ("%s (%s) %s: %u calls, %" G_GINT64_FORMAT " ms total, %" G_GINT64_FORMAT " ms max%s",
+			       stats->type_name, stats->module_name, interface_names[i],
+			       iface_stats->calls,
+			       iface_stats->total_usec / 1000,
+			       iface_stats->max_usec / 1000,
+			       iface_stats->demoted ? ", demoted" : "");
+		}
+	}
 }
@@ -27,6 +27,15 @@
 
 G_BEGIN_DECLS
 
+typedef enum {
+	NAUTILUS_MODULE_INTERFACE_MENU,
+	NAUTILUS_MODULE_INTERFACE_INFO,
+	NAUTILUS_MODULE_INTERFACE_COLUMN,
+	NAUTILUS_MODULE_INTERFACE_PROPERTY_PAGE,
+	NAUTILUS_MODULE_INTERFACE_LOCATION_WIDGET,
+	NAUTILUS_MODULE_N_INTERFACES
+} NautilusModuleInterface;
+
 void   nautilus_module_setup                   (void);
 GList *nautilus_module_get_extensions_for_type (GType  type);
 void   nautilus_module_extension_list_free     (GList *list);
@@ -36,6 +45,19 @@ void   nautilus_module_extension_list_free     (GList *list);
  * without putting them in separate shared libraries */
 void   nautilus_module_add_type                (GType  type);
 
+/* Accounting of the time spent in extension providers. Callers take
+ * g_get_monotonic_time () before calling into @provider and record the
+ * call once it returns. */
+void      nautilus_module_record_call          (gpointer                provider,
+						NautilusModuleInterface iface,
+						gint64                  start_time);
+/* Whether @provider went over the latency budget too often and should
+ * be run deferred rather than right away */
+gboolean  nautilus_module_provider_is_demoted  (gpointer                provider,
+						NautilusModuleInterface iface);
+GVariant *nautilus_module_get_statistics       (void);
+void      nautilus_module_debug_statistics     (void);
+
 G_END_DECLS
 
 #endif
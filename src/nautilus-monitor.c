@@ -27,13 +27,29 @@
 #include "nautilus-monitor.h"
 #include "nautilus-file-changes-queue.h"
 #include "nautilus-file-utilities.h"
+#include "nautilus-directory-notify.h"
+#include "nautilus-directory-private.h"
+#include "nautilus-file.h"
 
 #include <gio/gio.h>
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <glib-unix.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+
+typedef struct NativeWatch NativeWatch;
+#endif
+
 struct NautilusMonitor {
 	GFileMonitor *monitor;
 	GVolumeMonitor *volume_monitor;
 	GFile *location;
+#ifdef HAVE_SYS_INOTIFY_H
+	NativeWatch *native_watch;
+#endif
 };
 
 static gboolean call_consume_changes_idle_id = 0;
@@ -55,6 +71,443 @@ schedule_call_consume_changes (void)
 	}
 }
 
+/* The events of all the monitors are folded into the latest state of each
+ * file and delivered together, one batch per folder, at most every
+ * CHANGES_COALESCE_MSEC. Repeated changes are reported once, and a file
+ * created and deleted again in between is not reported at all.
+ */
+#define CHANGES_COALESCE_MSEC 100
+
+typedef enum {
+	PENDING_ADDED,
+	PENDING_CHANGED,
+	PENDING_REMOVED
+} PendingChange;
+
+typedef struct {
+	GList *added;
+	GList *changed;
+	GList *removed;
+} PendingDirectoryChanges;
+
+/* GFile -> PendingChange */
+static GHashTable *pending_changes = NULL;
+static guint flush_pending_changes_id = 0;
+
+static void
+pending_directory_changes_free (PendingDirectoryChanges *changes)
+{
+	g_list_free_full (changes->added, g_object_unref);
+	g_list_free_full (changes->changed, g_object_unref);
+	g_list_free_full (changes->removed, g_object_unref);
+	g_free (changes);
+}
+
+static gboolean
+flush_pending_changes_cb (gpointer not_used)
+{
+	GHashTable *pending, *directories;
+	GHashTableIter iter;
+	PendingDirectoryChanges *changes;
+	gpointer key, value;
+	GFile *file, *parent;
+
+	flush_pending_changes_id = 0;
+
+	pending = pending_changes;
+	pending_changes = NULL;
+
+	/* Deliver what the file operations queued first, so the two
+	 * sources stay in order */
+	nautilus_file_changes_consume_changes (TRUE);
+
+	if (pending == NULL) {
+		return FALSE;
+	}
+
+	directories = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+					     g_object_unref,
+					     (GDestroyNotify) pending_directory_changes_free);
+
+	g_hash_table_iter_init (&iter, pending);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		file = key;
+
+		parent = g_file_get_parent (file);
+		if (parent == NULL) {
+			parent = g_object_ref (file);
+		}
+
+		changes = g_hash_table_lookup (directories, parent);
+		if (changes == NULL) {
+			changes = g_new0 (PendingDirectoryChanges, 1);
+			g_hash_table_insert (directories, g_object_ref (parent), changes);
+		}
+		g_object_unref (parent);
+
+		switch (GPOINTER_TO_INT (value)) {
+		case PENDING_ADDED:
+			changes->added = g_list_prepend (changes->added, g_object_ref (file));
+			break;
+		case PENDING_CHANGED:
+			changes->changed = g_list_prepend (changes->changed, g_object_ref (file));
+			break;
+		case PENDING_REMOVED:
+			changes->removed = g_list_prepend (changes->removed, g_object_ref (file));
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+	g_hash_table_destroy (pending);
+
+	g_hash_table_iter_init (&iter, directories);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		changes = value;
+
+		if (changes->removed != NULL) {
+			nautilus_directory_notify_files_removed (changes->removed);
+		}
+		if (changes->added != NULL) {
+			nautilus_directory_notify_files_added (changes->added);
+		}
+		if (changes->changed != NULL) {
+			nautilus_directory_notify_files_changed (changes->changed);
+		}
+	}
+	g_hash_table_destroy (directories);
+
+	return FALSE;
+}
+
+static void
+queue_pending_change (GFile *file,
+		      PendingChange change)
+{
+	NautilusFile *existing;
+	gpointer value;
+	PendingChange old_change;
+
+	if (pending_changes == NULL) {
+		pending_changes = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+							 g_object_unref, NULL);
+	}
+
+	if (g_hash_table_lookup_extended (pending_changes, file, NULL, &value)) {
+		old_change = GPOINTER_TO_INT (value);
+
+		switch (change) {
+		case PENDING_ADDED:
+		case PENDING_CHANGED:
+			/* A file removed and created again was replaced */
+			if (old_change == PENDING_ADDED) {
+				change = PENDING_ADDED;
+			} else {
+				change = PENDING_CHANGED;
+			}
+			break;
+		case PENDING_REMOVED:
+			if (old_change != PENDING_ADDED) {
+				break;
+			}
+
+			/* Nobody saw it, unless a file operation reported it already */
+			existing = nautilus_file_get_existing (file);
+			if (existing == NULL) {
+				g_hash_table_remove (pending_changes, file);
+				return;
+			}
+			nautilus_file_unref (existing);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+
+	g_hash_table_replace (pending_changes, g_object_ref (file), GINT_TO_POINTER (change));
+
+	if (flush_pending_changes_id == 0) {
+		flush_pending_changes_id = g_timeout_add (CHANGES_COALESCE_MSEC,
+							  flush_pending_changes_cb, NULL);
+	}
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* Local folders are watched through a single inotify instance shared by
+ * the whole process. Every folder has one watch however many monitors
+ * ask for it, and the events go straight into the pending changes above.
+ * The watches are limited to a share of the per user inotify limit, so
+ * big expanded trees don't starve other applications. Past that budget
+ * folders fall back to GFileMonitor.
+ *
+ * The descriptor belongs to the inode, not the path: a folder reached
+ * through a symlink or a bind mount shares the watch of the other paths
+ * to it, so the watch keeps all of them and reports every event under
+ * each one.
+ */
+#define NATIVE_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+			   IN_ATTRIB | IN_CLOSE_WRITE | \
+			   IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR)
+#define NATIVE_WATCH_DEFAULT_BUDGET 8192
+
+struct NativeWatch {
+	int wd;
+	/* One entry per monitor, the same path may show up several times */
+	GList *locations;
+};
+
+static int native_watch_fd = -1;
+static guint native_watch_source_id = 0;
+static guint native_watch_budget = 0;
+/* int wd -> NativeWatch */
+static GHashTable *native_watches = NULL;
+
+static guint
+native_watch_get_budget (void)
+{
+	FILE *file;
+	guint max_watches;
+
+	max_watches = 0;
+	file = fopen ("/proc/sys/fs/inotify/max_user_watches", "r");
+	if (file != NULL) {
+		if (fscanf (file, "%u", &max_watches) != 1) {
+			max_watches = 0;
+		}
+		fclose (file);
+	}
+
+	if (max_watches == 0) {
+		return NATIVE_WATCH_DEFAULT_BUDGET;
+	}
+
+	/* Leave half of them to everybody else */
+	return max_watches / 2;
+}
+
+static int
+compare_location (GFile *a,
+		  GFile *b)
+{
+	return g_file_equal (a, b) ? 0 : 1;
+}
+
+static void
+native_watch_detach (NativeWatch *watch)
+{
+	g_hash_table_remove (native_watches, GINT_TO_POINTER (watch->wd));
+	watch->wd = -1;
+}
+
+static void
+native_watches_overflowed (void)
+{
+	GHashTableIter iter;
+	gpointer value;
+	GList *locations, *l, *w;
+	NautilusDirectory *directory;
+
+	/* Events were lost, read the watched folders again */
+	locations = NULL;
+	g_hash_table_iter_init (&iter, native_watches);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		for (w = ((NativeWatch *) value)->locations; w != NULL; w = w->next) {
+			if (g_list_find_custom (locations, w->data,
+						(GCompareFunc) compare_location) == NULL) {
+				locations = g_list_prepend (locations, g_object_ref (w->data));
+			}
+		}
+	}
+
+	for (l = locations; l != NULL; l = l->next) {
+		directory = nautilus_directory_get_existing (l->data);
+		if (directory != NULL) {
+			nautilus_directory_force_reload (directory);
+			nautilus_directory_unref (directory);
+		}
+	}
+
+	g_list_free_full (locations, g_object_unref);
+}
+
+static void
+native_watch_queue_event (GFile *location,
+			  const struct inotify_event *event)
+{
+	GFile *child;
+
+	if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT)) {
+		queue_pending_change (location, PENDING_REMOVED);
+		return;
+	}
+
+	if (event->len == 0) {
+		return;
+	}
+
+	child = g_file_get_child (location, event->name);
+
+	if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+		queue_pending_change (child, PENDING_ADDED);
+	} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+		queue_pending_change (child, PENDING_REMOVED);
+	} else if (event->mask & (IN_ATTRIB | IN_CLOSE_WRITE)) {
+		queue_pending_change (child, PENDING_CHANGED);
+	}
+
+	g_object_unref (child);
+}
+
+static void
+native_watch_handle_event (const struct inotify_event *event)
+{
+	NativeWatch *watch;
+	GList *l;
+
+	if (event->mask & IN_Q_OVERFLOW) {
+		native_watches_overflowed ();
+		return;
+	}
+
+	watch = g_hash_table_lookup (native_watches, GINT_TO_POINTER (event->wd));
+	if (watch == NULL) {
+		return;
+	}
+
+	if (event->mask & IN_IGNORED) {
+		/* The kernel dropped the watch, its monitors go quiet */
+		native_watch_detach (watch);
+		return;
+	}
+
+	for (l = watch->locations; l != NULL; l = l->next) {
+		/* Report each path once, however many monitors it has */
+		if (g_list_find_custom (watch->locations, l->data,
+					(GCompareFunc) compare_location) != l) {
+			continue;
+		}
+		native_watch_queue_event (l->data, event);
+	}
+}
+
+static gboolean
+native_watch_fd_ready (gint fd,
+		       GIOCondition condition,
+		       gpointer user_data)
+{
+	char buffer[64 * 1024] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	const struct inotify_event *event;
+	gssize len;
+	char *p;
+
+	len = read (fd, buffer, sizeof (buffer));
+	if (len < 0 && (errno == EINTR || errno == EAGAIN)) {
+		return G_SOURCE_CONTINUE;
+	}
+	if (len <= 0) {
+		g_warning ("Failed to read the folder change events: %s", g_strerror (errno));
+		native_watch_source_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	for (p = buffer; p < buffer + len; p += sizeof (struct inotify_event) + event->len) {
+		event = (const struct inotify_event *) p;
+		native_watch_handle_event (event);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+native_watch_init (void)
+{
+	if (native_watch_fd >= 0) {
+		return native_watch_source_id != 0;
+	}
+
+	native_watch_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (native_watch_fd < 0) {
+		return FALSE;
+	}
+
+	native_watches = g_hash_table_new (NULL, NULL);
+	native_watch_budget = native_watch_get_budget ();
+	native_watch_source_id = g_unix_fd_add (native_watch_fd, G_IO_IN,
+						native_watch_fd_ready, NULL);
+
+	return TRUE;
+}
+
+static NativeWatch *
+native_watch_get (GFile *location)
+{
+	NativeWatch *watch;
+	char *path;
+	int wd;
+
+	if (!g_file_is_native (location) || !native_watch_init ()) {
+		return NULL;
+	}
+
+	path = g_file_get_path (location);
+	if (path == NULL) {
+		return NULL;
+	}
+
+	/* inotify hands out the same descriptor for the same folder,
+	 * whichever path it was reached through */
+	wd = inotify_add_watch (native_watch_fd, path, NATIVE_WATCH_MASK);
+	g_free (path);
+
+	if (wd < 0) {
+		return NULL;
+	}
+
+	watch = g_hash_table_lookup (native_watches, GINT_TO_POINTER (wd));
+	if (watch != NULL) {
+		watch->locations = g_list_prepend (watch->locations, g_object_ref (location));
+		return watch;
+	}
+
+	if (g_hash_table_size (native_watches) >= native_watch_budget) {
+		inotify_rm_watch (native_watch_fd, wd);
+		return NULL;
+	}
+
+	watch = g_new0 (NativeWatch, 1);
+	watch->wd = wd;
+	watch->locations = g_list_prepend (NULL, g_object_ref (location));
+	g_hash_table_insert (native_watches, GINT_TO_POINTER (wd), watch);
+
+	return watch;
+}
+
+static void
+native_watch_unref (NativeWatch *watch,
+		    GFile *location)
+{
+	GList *l;
+
+	l = g_list_find_custom (watch->locations, location, (GCompareFunc) compare_location);
+	g_assert (l != NULL);
+
+	g_object_unref (l->data);
+	watch->locations = g_list_delete_link (watch->locations, l);
+	if (watch->locations != NULL) {
+		return;
+	}
+
+	if (watch->wd >= 0) {
+		inotify_rm_watch (native_watch_fd, watch->wd);
+		native_watch_detach (watch);
+	}
+
+	g_free (watch);
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
 static void
 mount_removed (GVolumeMonitor *volume_monitor,
 	       GMount *mount,
@@ -80,14 +533,6 @@ dir_changed (GFileMonitor* monitor,
 	     GFileMonitorEvent event_type,
 	     gpointer user_data)
 {
-	char *uri, *to_uri;
-	
-	uri = g_file_get_uri (child);
-	to_uri = NULL;
-	if (other_file) {
-		to_uri = g_file_get_uri (other_file);
-	}
-
 	switch (event_type) {
 	default:
 	case G_FILE_MONITOR_EVENT_CHANGED:
@@ -95,21 +540,16 @@ dir_changed (GFileMonitor* monitor,
 		break;
 	case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
 	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
-		nautilus_file_changes_queue_file_changed (child);
+		queue_pending_change (child, PENDING_CHANGED);
 		break;
 	case G_FILE_MONITOR_EVENT_UNMOUNTED:
 	case G_FILE_MONITOR_EVENT_DELETED:
-		nautilus_file_changes_queue_file_removed (child);
+		queue_pending_change (child, PENDING_REMOVED);
 		break;
 	case G_FILE_MONITOR_EVENT_CREATED:
-		nautilus_file_changes_queue_file_added (child);
+		queue_pending_change (child, PENDING_ADDED);
 		break;
 	}
-
-	g_free (uri);
-	g_free (to_uri);
-
-	schedule_call_consume_changes ();
 }
  
 NautilusMonitor *
@@ -119,6 +559,15 @@ nautilus_monitor_directory (GFile *location)
 	NautilusMonitor *ret;
 
 	ret = g_slice_new0 (NautilusMonitor);
+
+#ifdef HAVE_SYS_INOTIFY_H
+	ret->native_watch = native_watch_get (location);
+	if (ret->native_watch != NULL) {
+		ret->location = g_object_ref (location);
+		return ret;
+	}
+#endif
+
 	dir_monitor = g_file_monitor_directory (location, G_FILE_MONITOR_WATCH_MOUNTS, NULL, NULL);
 
 	if (dir_monitor != NULL) {
@@ -156,6 +605,12 @@ nautilus_monitor_cancel (NautilusMonitor *monitor)
 		g_object_unref (monitor->volume_monitor);
 	}
 
+#ifdef HAVE_SYS_INOTIFY_H
+	if (monitor->native_watch != NULL) {
+		native_watch_unref (monitor->native_watch, monitor->location);
+	}
+#endif
+
 	g_clear_object (&monitor->location);
 	g_slice_free (NautilusMonitor, monitor);
 }
@@ -0,0 +1,436 @@
+/* nautilus-native-dir.c - Directory fd based access to local folders.
+
+   Copyright (C) 2016 Free Software Foundation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config.h>
+#include "nautilus-native-dir.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#if defined (__linux__) && defined (SYS_getdents64)
+#define USE_GETDENTS64 1
+#endif
+
+/* Enough for a few hundred entries per getdents64() call */
+#define NATIVE_DIR_BUFFER_SIZE (64 * 1024)
+
+#ifdef USE_GETDENTS64
+struct linux_dirent64 {
+	guint64        d_ino;
+	gint64         d_off;
+	unsigned short d_reclen;
+	unsigned char  d_type;
+	char           d_name[];
+};
+#endif
+
+struct NautilusNativeDir {
+	volatile gint ref_count;
+	int fd;
+	char *path;
+	dev_t device;
+
+	NautilusNativeDirEntry entry;
+#ifdef USE_GETDENTS64
+	char *buffer;
+	gssize buffer_len;
+	gssize buffer_pos;
+#else
+	DIR *dirp;
+#endif
+	gboolean at_end;
+};
+
+static void
+set_error_from_errno (GError **error,
+		      int errsv)
+{
+	g_set_error_literal (error, G_IO_ERROR,
+			     g_io_error_from_errno (errsv),
+			     g_strerror (errsv));
+}
+
+static NautilusNativeDir *
+native_dir_new_for_fd (int fd,
+		       char *path,
+		       GError **error)
+{
+	NautilusNativeDir *dir;
+	struct stat statbuf;
+	int errsv;
+
+	if (fstat (fd, &statbuf) != 0) {
+		errsv = errno;
+		close (fd);
+		g_free (path);
+		set_error_from_errno (error, errsv);
+		return NULL;
+	}
+
+	dir = g_new0 (NautilusNativeDir, 1);
+	dir->ref_count = 1;
+	dir->fd = fd;
+	dir->path = path;
+	dir->device = statbuf.st_dev;
+
+	return dir;
+}
+
+NautilusNativeDir *
+nautilus_native_dir_open_path (const char *path,
+			       GError **error)
+{
+	int fd;
+
+	fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		set_error_from_errno (error, errno);
+		return NULL;
+	}
+
+	return native_dir_new_for_fd (fd, g_strdup (path), error);
+}
+
+NautilusNativeDir *
+nautilus_native_dir_open (GFile *location,
+			  GError **error)
+{
+	NautilusNativeDir *dir;
+	char *path;
+
+	path = g_file_get_path (location);
+	if (path == NULL) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+				     "Not a local folder");
+		return NULL;
+	}
+
+	dir = nautilus_native_dir_open_path (path, error);
+	g_free (path);
+
+	return dir;
+}
+
+NautilusNativeDir *
+nautilus_native_dir_open_child (NautilusNativeDir *dir,
+				const char *name,
+				GError **error)
+{
+	int fd;
+
+	fd = openat (dir->fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		set_error_from_errno (error, errno);
+		return NULL;
+	}
+
+	return native_dir_new_for_fd (fd, nautilus_native_dir_get_child_path (dir, name), error);
+}
+
+NautilusNativeDir *
+nautilus_native_dir_ref (NautilusNativeDir *dir)
+{
+	g_atomic_int_inc (&dir->ref_count);
+
+	return dir;
+}
+
+void
+nautilus_native_dir_close (NautilusNativeDir *dir)
+{
+	if (dir == NULL ||
+	    !g_atomic_int_dec_and_test (&dir->ref_count)) {
+		return;
+	}
+
+#ifdef USE_GETDENTS64
+	g_free (dir->buffer);
+	close (dir->fd);
+#else
+	if (dir->dirp != NULL) {
+		/* closedir() closes the fd as well */
+		closedir (dir->dirp);
+	} else {
+		close (dir->fd);
+	}
+#endif
+	g_free (dir->path);
+	g_free (dir);
+}
+
+int
+nautilus_native_dir_get_fd (NautilusNativeDir *dir)
+{
+	return dir->fd;
+}
+
+const char *
+nautilus_native_dir_get_path (NautilusNativeDir *dir)
+{
+	return dir->path;
+}
+
+dev_t
+nautilus_native_dir_get_device (NautilusNativeDir *dir)
+{
+	return dir->device;
+}
+
+char *
+nautilus_native_dir_get_child_path (NautilusNativeDir *dir,
+				    const char *name)
+{
+	return g_build_filename (dir->path, name, NULL);
+}
+
+static gboolean
+is_dot_or_dotdot (const char *name)
+{
+	return name[0] == '.' &&
+	       (name[1] == 0 || (name[1] == '.' && name[2] == 0));
+}
+
+const NautilusNativeDirEntry *
+nautilus_native_dir_next (NautilusNativeDir *dir,
+			  GError **error)
+{
+#ifdef USE_GETDENTS64
+	struct linux_dirent64 *dirent;
+	long res;
+
+	while (!dir->at_end) {
+		if (dir->buffer_pos >= dir->buffer_len) {
+			if (dir->buffer == NULL) {
+				dir->buffer = g_malloc (NATIVE_DIR_BUFFER_SIZE);
+			}
+
+			res = syscall (SYS_getdents64, dir->fd, dir->buffer, NATIVE_DIR_BUFFER_SIZE);
+			if (res < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				dir->at_end = TRUE;
+				set_error_from_errno (error, errno);
+				return NULL;
+			}
+			if (res == 0) {
+				dir->at_end = TRUE;
+				return NULL;
+			}
+
+			dir->buffer_len = res;
+			dir->buffer_pos = 0;
+		}
+
+		dirent = (struct linux_dirent64 *) (dir->buffer + dir->buffer_pos);
+		dir->buffer_pos += dirent->d_reclen;
+
+		if (!is_dot_or_dotdot (dirent->d_name)) {
+			dir->entry.name = dirent->d_name;
+			dir->entry.type = dirent->d_type;
+			return &dir->entry;
+		}
+	}
+
+	return NULL;
+#else
+	struct dirent *dirent;
+	int fd;
+	int errsv;
+
+	if (dir->dirp == NULL && !dir->at_end) {
+		/* fdopendir() takes over the fd, keep our own copy */
+		fd = dup (dir->fd);
+		if (fd < 0 || (dir->dirp = fdopendir (fd)) == NULL) {
+			errsv = errno;
+			if (fd >= 0) {
+				close (fd);
+			}
+			dir->at_end = TRUE;
+			set_error_from_errno (error, errsv);
+			return NULL;
+		}
+	}
+
+	while (!dir->at_end) {
+		errno = 0;
+		dirent = readdir (dir->dirp);
+		if (dirent == NULL) {
+			dir->at_end = TRUE;
+			if (errno != 0) {
+				set_error_from_errno (error, errno);
+			}
+			return NULL;
+		}
+
+		if (!is_dot_or_dotdot (dirent->d_name)) {
+			dir->entry.name = dirent->d_name;
+			dir->entry.type = dirent->d_type;
+			return &dir->entry;
+		}
+	}
+
+	return NULL;
+#endif
+}
+
+gboolean
+nautilus_native_dir_stat (NautilusNativeDir *dir,
+			  const char *name,
+			  struct stat *statbuf,
+			  GError **error)
+{
+	if (fstatat (dir->fd, name, statbuf, AT_SYMLINK_NOFOLLOW) != 0) {
+		set_error_from_errno (error, errno);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gboolean
+nautilus_native_dir_entry_is_dir (NautilusNativeDir *dir,
+				  const NautilusNativeDirEntry *entry)
+{
+	struct stat statbuf;
+
+	if (entry->type != DT_UNKNOWN) {
+		return entry->type == DT_DIR;
+	}
+
+	return nautilus_native_dir_stat (dir, entry->name, &statbuf, NULL) &&
+	       S_ISDIR (statbuf.st_mode);
+}
+
+gboolean
+nautilus_native_dir_unlink (NautilusNativeDir *dir,
+			    const char *name,
+			    gboolean is_dir,
+			    GError **error)
+{
+	if (unlinkat (dir->fd, name, is_dir ? AT_REMOVEDIR : 0) != 0) {
+		set_error_from_errno (error, errno);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gboolean
+nautilus_native_dir_rename (NautilusNativeDir *dir,
+			    const char *name,
+			    NautilusNativeDir *dest_dir,
+			    const char *dest_name,
+			    GError **error)
+{
+	struct stat statbuf;
+
+#ifdef HAVE_RENAMEAT2
+	if (renameat2 (dir->fd, name, dest_dir->fd, dest_name, RENAME_NOREPLACE) == 0) {
+		return TRUE;
+	}
+	if (errno != EINVAL && errno != ENOSYS) {
+		set_error_from_errno (error, errno);
+		return FALSE;
+	}
+#endif
+
+	/* The filesystem doesn't support RENAME_NOREPLACE, check by hand
+	 * the same way g_file_move() does. */
+	if (fstatat (dest_dir->fd, dest_name, &statbuf, AT_SYMLINK_NOFOLLOW) == 0) {
+		set_error_from_errno (error, EEXIST);
+		return FALSE;
+	} else if (errno != ENOENT) {
+		set_error_from_errno (error, errno);
+		return FALSE;
+	}
+
+	if (renameat (dir->fd, name, dest_dir->fd, dest_name) != 0) {
+		set_error_from_errno (error, errno);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gboolean
+nautilus_native_dir_chmod (NautilusNativeDir *dir,
+			   const char *name,
+			   mode_t mode,
+			   GError **error)
+{
+#ifdef O_PATH
+	struct stat statbuf;
+	char *proc_path;
+	int fd;
+	int res;
+#endif
+
+	if (fchmodat (dir->fd, name, mode, AT_SYMLINK_NOFOLLOW) == 0) {
+		return TRUE;
+	}
+	if (errno != ENOTSUP && errno != EOPNOTSUPP) {
+		set_error_from_errno (error, errno);
+		return FALSE;
+	}
+
+#ifdef O_PATH
+	/* The C library can't do AT_SYMLINK_NOFOLLOW, or the child is a
+	 * symlink whose mode can't be changed. Pin the child without
+	 * following it and change it through its fd, the way newer C
+	 * libraries do.
+	 */
+	fd = openat (dir->fd, name, O_PATH | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		set_error_from_errno (error, errno);
+		return FALSE;
+	}
+
+	if (fstat (fd, &statbuf) != 0) {
+		set_error_from_errno (error, errno);
+		close (fd);
+		return FALSE;
+	}
+
+	if (S_ISLNK (statbuf.st_mode)) {
+		close (fd);
+		set_error_from_errno (error, ENOTSUP);
+		return FALSE;
+	}
+
+	proc_path = g_strdup_printf ("/proc/self/fd/%d", fd);
+	res = chmod (proc_path, mode);
+	if (res != 0) {
+		set_error_from_errno (error, errno);
+	}
+	g_free (proc_path);
+	close (fd);
+
+	return res == 0;
+#else
+	set_error_from_errno (error, errno);
+	return FALSE;
+#endif
+}
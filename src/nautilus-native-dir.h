@@ -0,0 +1,94 @@
+/* nautilus-native-dir.h - Directory fd based access to local folders.
+
+   Copyright (C) 2016 Free Software Foundation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NAUTILUS_NATIVE_DIR_H
+#define NAUTILUS_NATIVE_DIR_H
+
+#include <gio/gio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* A local folder held open by its fd. The children are read in large
+ * batches and every operation on them is done relative to the fd, so
+ * walking a deep tree neither resolves full paths again in each syscall
+ * nor needs a GFile per child. Errors are reported as G_IO_ERROR, like
+ * the GIO calls this replaces on the file operation fast paths.
+ */
+typedef struct NautilusNativeDir NautilusNativeDir;
+
+typedef struct {
+	const char *name;
+	/* One of the DT_* values, DT_UNKNOWN if the filesystem doesn't say */
+	guchar type;
+} NautilusNativeDirEntry;
+
+/* Symlinks to folders are never opened, neither by the open functions
+ * nor by nautilus_native_dir_open_child(). nautilus_native_dir_open()
+ * fails with G_IO_ERROR_NOT_SUPPORTED for non native locations.
+ */
+NautilusNativeDir *           nautilus_native_dir_open           (GFile              *location,
+								  GError            **error);
+NautilusNativeDir *           nautilus_native_dir_open_path      (const char         *path,
+								  GError            **error);
+NautilusNativeDir *           nautilus_native_dir_open_child     (NautilusNativeDir  *dir,
+								  const char         *name,
+								  GError            **error);
+/* Folders handed to other threads are kept open with a reference, the
+ * fd is closed with the last nautilus_native_dir_close(). Only reading
+ * the children with nautilus_native_dir_next() is not thread safe.
+ */
+NautilusNativeDir *           nautilus_native_dir_ref            (NautilusNativeDir  *dir);
+void                          nautilus_native_dir_close          (NautilusNativeDir  *dir);
+
+int                           nautilus_native_dir_get_fd         (NautilusNativeDir  *dir);
+const char *                  nautilus_native_dir_get_path       (NautilusNativeDir  *dir);
+dev_t                         nautilus_native_dir_get_device     (NautilusNativeDir  *dir);
+char *                        nautilus_native_dir_get_child_path (NautilusNativeDir  *dir,
+								  const char         *name);
+
+/* Returns the next child, skipping "." and "..", or NULL at the end or
+ * on error. The entry is only valid until the next call.
+ */
+const NautilusNativeDirEntry *nautilus_native_dir_next           (NautilusNativeDir  *dir,
+								  GError            **error);
+
+/* The children are never followed if they are symlinks */
+gboolean                      nautilus_native_dir_stat           (NautilusNativeDir  *dir,
+								  const char         *name,
+								  struct stat        *statbuf,
+								  GError            **error);
+gboolean                      nautilus_native_dir_entry_is_dir   (NautilusNativeDir  *dir,
+								  const NautilusNativeDirEntry *entry);
+gboolean                      nautilus_native_dir_unlink         (NautilusNativeDir  *dir,
+								  const char         *name,
+								  gboolean            is_dir,
+								  GError            **error);
+/* Fails with G_IO_ERROR_EXISTS instead of replacing an existing file */
+gboolean                      nautilus_native_dir_rename         (NautilusNativeDir  *dir,
+								  const char         *name,
+								  NautilusNativeDir  *dest_dir,
+								  const char         *dest_name,
+								  GError            **error);
+/* Never follows symlinks: a child that is one, or was replaced by one,
+ * fails with G_IO_ERROR_NOT_SUPPORTED */
+gboolean                      nautilus_native_dir_chmod          (NautilusNativeDir  *dir,
+								  const char         *name,
+								  mode_t              mode,
+								  GError            **error);
+
+#endif /* NAUTILUS_NATIVE_DIR_H */
@@ -37,6 +37,9 @@ enum {
 
 static NautilusProgressInfoManager *singleton = NULL;
 
+/* Mirrors current_viewers != NULL for the file operation threads */
+static volatile gint has_viewers_any_thread = FALSE;
+
 static guint signals[LAST_SIGNAL] = { 0, };
 
 G_DEFINE_TYPE (NautilusProgressInfoManager, nautilus_progress_info_manager,
@@ -186,8 +189,10 @@ remove_viewer (NautilusProgressInfoManager *self,
 {
         self->priv->current_viewers = g_list_remove (self->priv->current_viewers, viewer);
 
-        if (self->priv->current_viewers == NULL)
+        if (self->priv->current_viewers == NULL) {
+                g_atomic_int_set (&has_viewers_any_thread, FALSE);
                 g_signal_emit (self, signals[HAS_VIEWERS_CHANGED], 0);
+        }
 }
 
 void
@@ -202,8 +207,10 @@ nautilus_progress_manager_add_viewer (NautilusProgressInfoManager *self,
                 viewers = g_list_append (viewers, viewer);
                 self->priv->current_viewers = viewers;
 
-                if (g_list_length (viewers) == 1)
+                if (g_list_length (viewers) == 1) {
+                        g_atomic_int_set (&has_viewers_any_thread, TRUE);
                         g_signal_emit (self, signals[HAS_VIEWERS_CHANGED], 0);
+                }
         }
 }
 
@@ -222,3 +229,12 @@ nautilus_progress_manager_has_viewers (NautilusProgressInfoManager *self)
 {
         return self->priv->current_viewers != NULL;
 }
+
+/* Like nautilus_progress_manager_has_viewers(), but safe to call from the
+ * file operation threads, which use it to skip formatting the status and
+ * details nobody is looking at. */
+gboolean
+nautilus_progress_manager_has_viewers_any_thread (void)
+{
+        return g_atomic_int_get (&has_viewers_any_thread);
+}
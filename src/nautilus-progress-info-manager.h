@@ -67,6 +67,7 @@ gboolean nautilus_progress_manager_are_all_infos_finished_or_cancelled (Nautilus
 void nautilus_progress_manager_add_viewer (NautilusProgressInfoManager *self, GObject *viewer);
 void nautilus_progress_manager_remove_viewer (NautilusProgressInfoManager *self, GObject *viewer);
 gboolean nautilus_progress_manager_has_viewers (NautilusProgressInfoManager *self);
+gboolean nautilus_progress_manager_has_viewers_any_thread (void);
 
 G_END_DECLS
 
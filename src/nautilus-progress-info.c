@@ -61,8 +61,7 @@ struct _NautilusProgressInfo
 	gboolean finished;
 	gboolean paused;
 	
-	GSource *idle_source;
-	gboolean source_is_now;
+	gboolean queued;
 	
 	gboolean start_at_idle;
 	gboolean finish_at_idle;
@@ -80,6 +79,14 @@ struct _NautilusProgressInfoClass
 
 G_LOCK_DEFINE_STATIC(progress_info);
 
+/* All the infos share one source, so any number of concurrent operations
+ * costs a single main loop wakeup per SIGNAL_DELAY_MSEC. The queued infos
+ * are kept alive until their signals have been emitted.
+ */
+static GSource *idle_source = NULL;
+static gboolean source_is_now = FALSE;
+static GList *queued_infos = NULL;
+
 G_DEFINE_TYPE (NautilusProgressInfo, nautilus_progress_info, G_TYPE_OBJECT)
 
 static void
@@ -103,33 +110,12 @@ nautilus_progress_info_finalize (GObject *object)
 	}
 }
 
-static void
-nautilus_progress_info_dispose (GObject *object)
-{
-	NautilusProgressInfo *info;
-	
-	info = NAUTILUS_PROGRESS_INFO (object);
-
-	G_LOCK (progress_info);
-
-	/* Destroy source in dispose, because the callback
-	   could come here before the destroy, which should
-	   ressurect the object for a while */
-	if (info->idle_source) {
-		g_source_destroy (info->idle_source);
-		g_source_unref (info->idle_source);
-		info->idle_source = NULL;
-	}
-	G_UNLOCK (progress_info);
-}
-
 static void
 nautilus_progress_info_class_init (NautilusProgressInfoClass *klass)
 {
 	GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 	
 	gobject_class->finalize = nautilus_progress_info_finalize;
-	gobject_class->dispose = nautilus_progress_info_dispose;
 	
 	signals[CHANGED] =
 		g_signal_new ("changed",
@@ -177,23 +163,31 @@ nautilus_progress_info_class_init (NautilusProgressInfoClass *klass)
 			      G_TYPE_NONE, 0);
 }
 
-static gboolean
-idle_callback (gpointer data)
-{
-	NautilusProgressInfo *info = data;
+typedef struct {
+	NautilusProgressInfo *info;
 	gboolean start_at_idle;
 	gboolean finish_at_idle;
 	gboolean changed_at_idle;
 	gboolean progress_at_idle;
 	gboolean cancelled_at_idle;
+} QueuedSignals;
+
+static gboolean
+idle_callback (gpointer data)
+{
+	NautilusProgressInfo *info;
+	QueuedSignals *queued;
+	GArray *signals_array;
 	GSource *source;
+	GList *infos, *l;
+	guint i;
 
 	source = g_main_current_source ();
 
 	G_LOCK (progress_info);
 
 	/* Protect agains races where the source has
-	   been destroyed on another thread while it
+	   been replaced on another thread while it
 	   was being dispatched.
 	   Similar to what gdk_threads_add_idle does.
 	*/
@@ -202,62 +196,81 @@ idle_callback (gpointer data)
 		return FALSE;
 	}
 
-	/* We hadn't destroyed the source, so take a ref.
-	 * This might ressurect the object from dispose, but
-	 * that should be ok.
-	 */
-	g_object_ref (info);
+	g_assert (source == idle_source);
 
-	g_assert (source == info->idle_source);
+	g_source_unref (idle_source);
+	idle_source = NULL;
 
-	g_source_unref (source);
-	info->idle_source = NULL;
+	infos = g_list_reverse (queued_infos);
+	queued_infos = NULL;
 
-	start_at_idle = info->start_at_idle;
-	finish_at_idle = info->finish_at_idle;
-	changed_at_idle = info->changed_at_idle;
-	progress_at_idle = info->progress_at_idle;
-	cancelled_at_idle = info->cancel_at_idle;
+	signals_array = g_array_sized_new (FALSE, FALSE, sizeof (QueuedSignals),
+					   g_list_length (infos));
 
-	info->start_at_idle = FALSE;
-	info->finish_at_idle = FALSE;
-	info->changed_at_idle = FALSE;
-	info->progress_at_idle = FALSE;
-	info->cancel_at_idle = FALSE;
+	for (l = infos; l != NULL; l = l->next) {
+		info = l->data;
 
-	G_UNLOCK (progress_info);
+		g_array_set_size (signals_array, signals_array->len + 1);
+		queued = &g_array_index (signals_array, QueuedSignals, signals_array->len - 1);
 
-	if (start_at_idle) {
-		g_signal_emit (info,
-			       signals[STARTED],
-			       0);
-	}
+		/* The reference taken by queue_idle() moves here */
+		queued->info = info;
+		queued->start_at_idle = info->start_at_idle;
+		queued->finish_at_idle = info->finish_at_idle;
+		queued->changed_at_idle = info->changed_at_idle;
+		queued->progress_at_idle = info->progress_at_idle;
+		queued->cancelled_at_idle = info->cancel_at_idle;
 
-	if (changed_at_idle) {
-		g_signal_emit (info,
-			       signals[CHANGED],
-			       0);
+		info->queued = FALSE;
+		info->start_at_idle = FALSE;
+		info->finish_at_idle = FALSE;
+		info->changed_at_idle = FALSE;
+		info->progress_at_idle = FALSE;
+		info->cancel_at_idle = FALSE;
 	}
 
-	if (progress_at_idle) {
-		g_signal_emit (info,
-			       signals[PROGRESS_CHANGED],
-			       0);
-	}
+	G_UNLOCK (progress_info);
 
-	if (finish_at_idle) {
-		g_signal_emit (info,
-			       signals[FINISHED],
-			       0);
-	}
+	g_list_free (infos);
+
+	for (i = 0; i < signals_array->len; i++) {
+		queued = &g_array_index (signals_array, QueuedSignals, i);
+		info = queued->info;
+
+		if (queued->start_at_idle) {
+			g_signal_emit (info,
+				       signals[STARTED],
+				       0);
+		}
 
-	if (cancelled_at_idle) {
-		g_signal_emit (info,
-			       signals[CANCELLED],
-			       0);
+		if (queued->changed_at_idle) {
+			g_signal_emit (info,
+				       signals[CHANGED],
+				       0);
+		}
+
+		if (queued->progress_at_idle) {
+			g_signal_emit (info,
+				       signals[PROGRESS_CHANGED],
+				       0);
+		}
+
+		if (queued->finish_at_idle) {
+			g_signal_emit (info,
+				       signals[FINISHED],
+				       0);
+		}
+
+		if (queued->cancelled_at_idle) {
+			g_signal_emit (info,
+				       signals[CANCELLED],
+				       0);
+		}
+
+		g_object_unref (info);
 	}
 
-	g_object_unref (info);
+	g_array_free (signals_array, TRUE);
 
 	return FALSE;
 }
@@ -267,22 +280,27 @@ idle_callback (gpointer data)
 static void
 queue_idle (NautilusProgressInfo *info, gboolean now)
 {
-	if (info->idle_source == NULL ||
-	    (now && !info->source_is_now)) {
-		if (info->idle_source) {
-			g_source_destroy (info->idle_source);
-			g_source_unref (info->idle_source);
-			info->idle_source = NULL;
+	if (!info->queued) {
+		info->queued = TRUE;
+		queued_infos = g_list_prepend (queued_infos, g_object_ref (info));
+	}
+
+	if (idle_source == NULL ||
+	    (now && !source_is_now)) {
+		if (idle_source) {
+			g_source_destroy (idle_source);
+			g_source_unref (idle_source);
+			idle_source = NULL;
 		}
 
-		info->source_is_now = now;
+		source_is_now = now;
 		if (now) {
-			info->idle_source = g_idle_source_new ();
+			idle_source = g_idle_source_new ();
 		} else {
-			info->idle_source = g_timeout_source_new (SIGNAL_DELAY_MSEC);
+			idle_source = g_timeout_source_new (SIGNAL_DELAY_MSEC);
 		}
-		g_source_set_callback (info->idle_source, idle_callback, info, NULL);
-		g_source_attach (info->idle_source, NULL);
+		g_source_set_callback (idle_source, idle_callback, NULL, NULL);
+		g_source_attach (idle_source, NULL);
 	}
 }
 
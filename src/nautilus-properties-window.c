@@ -4287,6 +4287,7 @@ append_extension_pages (NautilusPropertiesWindow *window)
 {
 	GList *providers;
 	GList *p;
+	gint64 start_time;
 	
  	providers = nautilus_module_get_extensions_for_type (NAUTILUS_TYPE_PROPERTY_PAGE_PROVIDER);
 	
@@ -4297,8 +4298,10 @@ append_extension_pages (NautilusPropertiesWindow *window)
 
 		provider = NAUTILUS_PROPERTY_PAGE_PROVIDER (p->data);
 		
+		start_time = g_get_monotonic_time ();
 		pages = nautilus_property_page_provider_get_pages 
 			(provider, window->details->original_files);
+		nautilus_module_record_call (provider, NAUTILUS_MODULE_INTERFACE_PROPERTY_PAGE, start_time);
 		
 		for (l = pages; l != NULL; l = l->next) {
 			NautilusPropertyPage *page;
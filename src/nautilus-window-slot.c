@@ -117,6 +117,11 @@ typedef struct {
 	GError *mount_error;
 	gboolean tried_mount;
         gint view_mode_before_search;
+
+        /* Folders we expect to be opened next, see prefetch_neighbours () */
+        NautilusDirectory *prefetch_selection;
+        GList *prefetch_neighbours;
+        guint prefetch_selection_timeout_id;
 } NautilusWindowSlotPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (NautilusWindowSlot, nautilus_window_slot, GTK_TYPE_BOX);
@@ -128,6 +133,8 @@ static void nautilus_window_slot_force_reload (NautilusWindowSlot *self);
 static void change_view (NautilusWindowSlot *self);
 static void hide_query_editor (NautilusWindowSlot *self);
 static void nautilus_window_slot_sync_actions (NautilusWindowSlot *self);
+static void cancel_prefetches (NautilusWindowSlot *self,
+                               GFile              *keep);
 static void nautilus_window_slot_connect_new_content_view (NautilusWindowSlot *self);
 static void nautilus_window_slot_disconnect_content_view (NautilusWindowSlot *self);
 static gboolean nautilus_window_slot_content_view_matches (NautilusWindowSlot *self, guint id);
@@ -873,6 +880,15 @@ check_force_reload (GFile                      *location,
 
 	if (type == NAUTILUS_LOCATION_CHANGE_RELOAD) {
 		force_reload = TRUE;
+	} else if (nautilus_directory_is_warm (directory) &&
+		   (type == NAUTILUS_LOCATION_CHANGE_BACK ||
+		    type == NAUTILUS_LOCATION_CHANGE_FORWARD)) {
+		/* Show what we still have right away and only reload
+		 * if the folder changed in the meantime */
+		force_reload = FALSE;
+		if (!nautilus_directory_is_local (directory)) {
+			nautilus_directory_revalidate (directory);
+		}
 	} else {
 		force_reload = !nautilus_directory_is_local (directory);
 	}
@@ -889,6 +905,20 @@ check_force_reload (GFile                      *location,
         nautilus_file_unref (file);
 }
 
+static void
+keep_location_warm (NautilusWindowSlot *self)
+{
+        NautilusWindowSlotPrivate *priv;
+        NautilusDirectory *directory;
+
+        priv = nautilus_window_slot_get_instance_private (self);
+        directory = nautilus_directory_get_existing (priv->location);
+        if (directory != NULL) {
+                nautilus_directory_keep_warm (directory);
+                nautilus_directory_unref (directory);
+        }
+}
+
 static void
 save_scroll_position_for_history (NautilusWindowSlot *self)
 {
@@ -962,6 +992,9 @@ begin_location_change (NautilusWindowSlot         *self,
 
 	priv->pending_scroll_to = g_strdup (scroll_pos);
 
+        keep_location_warm (self);
+        cancel_prefetches (self, location);
+
         check_force_reload (location, type);
 
         save_scroll_position_for_history (self);
@@ -2067,6 +2100,7 @@ slot_add_extension_extra_widgets (NautilusWindowSlot *self)
 	GtkWidget *widget;
 	char *uri;
 	NautilusWindow *window;
+	gint64 start_time;
 
 	providers = nautilus_module_get_extensions_for_type (NAUTILUS_TYPE_LOCATION_WIDGET_PROVIDER);
 	window = nautilus_window_slot_get_window (self);
@@ -2076,7 +2110,9 @@ slot_add_extension_extra_widgets (NautilusWindowSlot *self)
 		NautilusLocationWidgetProvider *provider;
 
 		provider = NAUTILUS_LOCATION_WIDGET_PROVIDER (l->data);
+		start_time = g_get_monotonic_time ();
 		widget = nautilus_location_widget_provider_get_widget (provider, uri, GTK_WIDGET (window));
+		nautilus_module_record_call (provider, NAUTILUS_MODULE_INTERFACE_LOCATION_WIDGET, start_time);
 		if (widget != NULL) {
 			nautilus_window_slot_add_extra_location_widget (self, widget);
 		}
@@ -2134,6 +2170,212 @@ view_started_loading (NautilusWindowSlot *self,
         nautilus_window_slot_set_loading (self, TRUE);
 }
 
+/* How long the selection has to stay on a folder before we start
+ * reading it */
+#define PREFETCH_SELECTION_DELAY 300
+
+static NautilusDirectory *
+prefetch_location (NautilusWindowSlot *self,
+                   GFile              *location)
+{
+        NautilusWindowSlotPrivate *priv;
+        NautilusDirectory *directory;
+
+        priv = nautilus_window_slot_get_instance_private (self);
+        if (location == NULL ||
+            (priv->location != NULL && g_file_equal (location, priv->location))) {
+                return NULL;
+        }
+
+        directory = nautilus_directory_get (location);
+        nautilus_directory_prefetch (directory, self);
+
+        return directory;
+}
+
+/* The prefetch of the folder being opened is left to finish, the view
+ * picks up from where it got. */
+static void
+cancel_prefetch (NautilusWindowSlot *self,
+                 NautilusDirectory  *directory,
+                 GFile              *keep)
+{
+        GFile *location;
+
+        location = nautilus_directory_get_location (directory);
+        if (keep == NULL || !g_file_equal (location, keep)) {
+                nautilus_directory_cancel_prefetch (directory, self);
+        }
+        g_object_unref (location);
+
+        nautilus_directory_unref (directory);
+}
+
+static void
+cancel_prefetches (NautilusWindowSlot *self,
+                   GFile              *keep)
+{
+        NautilusWindowSlotPrivate *priv;
+        GList *l;
+
+        priv = nautilus_window_slot_get_instance_private (self);
+
+        if (priv->prefetch_selection_timeout_id != 0) {
+                g_source_remove (priv->prefetch_selection_timeout_id);
+                priv->prefetch_selection_timeout_id = 0;
+        }
+
+        if (priv->prefetch_selection != NULL) {
+                cancel_prefetch (self, priv->prefetch_selection, keep);
+                priv->prefetch_selection = NULL;
+        }
+
+        for (l = priv->prefetch_neighbours; l != NULL; l = l->next) {
+                cancel_prefetch (self, l->data, keep);
+        }
+        g_list_free (priv->prefetch_neighbours);
+        priv->prefetch_neighbours = NULL;
+}
+
+static GList *
+find_prefetch (GList *directories,
+               GFile *location)
+{
+        GFile *directory_location;
+        GList *l;
+
+        for (l = directories; l != NULL; l = l->next) {
+                directory_location = nautilus_directory_get_location (l->data);
+                if (g_file_equal (directory_location, location)) {
+                        g_object_unref (directory_location);
+                        return l;
+                }
+                g_object_unref (directory_location);
+        }
+
+        return NULL;
+}
+
+/* Folders still in @previous are taken over as they are, so showing the
+ * same folder again doesn't stack up another reference to them */
+static void
+prefetch_neighbour (NautilusWindowSlot  *self,
+                    GFile               *location,
+                    GList              **previous)
+{
+        NautilusWindowSlotPrivate *priv;
+        NautilusDirectory *directory;
+        GList *l;
+
+        priv = nautilus_window_slot_get_instance_private (self);
+        if (location == NULL ||
+            find_prefetch (priv->prefetch_neighbours, location) != NULL) {
+                return;
+        }
+
+        l = find_prefetch (*previous, location);
+        if (l != NULL) {
+                *previous = g_list_remove_link (*previous, l);
+                priv->prefetch_neighbours = g_list_concat (l, priv->prefetch_neighbours);
+                return;
+        }
+
+        directory = prefetch_location (self, location);
+        if (directory != NULL) {
+                priv->prefetch_neighbours = g_list_prepend (priv->prefetch_neighbours, directory);
+        }
+}
+
+/* Once a folder is shown, read the ones we can get to from it in one
+ * click: its parent in the path bar and the next history entries. */
+static void
+prefetch_neighbours (NautilusWindowSlot *self)
+{
+        NautilusWindowSlotPrivate *priv;
+        GFile *parent, *location;
+        GList *previous, *l;
+
+        priv = nautilus_window_slot_get_instance_private (self);
+
+        /* A reload ends loading again, replace what the last one set up */
+        previous = priv->prefetch_neighbours;
+        priv->prefetch_neighbours = NULL;
+
+        if (priv->location != NULL) {
+                parent = g_file_get_parent (priv->location);
+                if (parent != NULL) {
+                        prefetch_neighbour (self, parent, &previous);
+                        g_object_unref (parent);
+                }
+
+                if (priv->back_list != NULL) {
+                        location = nautilus_bookmark_get_location (priv->back_list->data);
+                        prefetch_neighbour (self, location, &previous);
+                        g_object_unref (location);
+                }
+
+                if (priv->forward_list != NULL) {
+                        location = nautilus_bookmark_get_location (priv->forward_list->data);
+                        prefetch_neighbour (self, location, &previous);
+                        g_object_unref (location);
+                }
+        }
+
+        for (l = previous; l != NULL; l = l->next) {
+                cancel_prefetch (self, l->data, NULL);
+        }
+        g_list_free (previous);
+}
+
+static gboolean
+prefetch_selection_timeout_callback (gpointer user_data)
+{
+        NautilusWindowSlot *self;
+        NautilusWindowSlotPrivate *priv;
+        NautilusFile *file;
+        GFile *location;
+        GList *selection;
+
+        self = NAUTILUS_WINDOW_SLOT (user_data);
+        priv = nautilus_window_slot_get_instance_private (self);
+        priv->prefetch_selection_timeout_id = 0;
+
+        if (priv->prefetch_selection != NULL) {
+                cancel_prefetch (self, priv->prefetch_selection, NULL);
+                priv->prefetch_selection = NULL;
+        }
+
+        selection = nautilus_view_get_selection (priv->content_view);
+        if (selection != NULL && selection->next == NULL) {
+                file = NAUTILUS_FILE (selection->data);
+                if (nautilus_file_is_directory (file)) {
+                        location = nautilus_file_get_location (file);
+                        priv->prefetch_selection = prefetch_location (self, location);
+                        g_object_unref (location);
+                }
+        }
+        nautilus_file_list_free (selection);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+view_selection_changed_cb (NautilusView       *view,
+                           NautilusWindowSlot *self)
+{
+        NautilusWindowSlotPrivate *priv;
+
+        priv = nautilus_window_slot_get_instance_private (self);
+        if (priv->prefetch_selection_timeout_id != 0) {
+                g_source_remove (priv->prefetch_selection_timeout_id);
+        }
+
+        priv->prefetch_selection_timeout_id =
+                g_timeout_add (PREFETCH_SELECTION_DELAY,
+                               prefetch_selection_timeout_callback,
+                               self);
+}
+
 static void
 view_ended_loading (NautilusWindowSlot *self,
                     NautilusView       *view)
@@ -2147,6 +2389,7 @@ view_ended_loading (NautilusWindowSlot *self,
                 }
 
                 end_location_change (self);
+                prefetch_neighbours (self);
         }
 
         if (priv->needs_reload) {
@@ -2253,6 +2496,12 @@ nautilus_window_slot_connect_new_content_view (NautilusWindowSlot *self)
                                   "notify::is-loading",
                                   G_CALLBACK (view_is_loading_changed_cb),
                                   self);
+                if (NAUTILUS_IS_FILES_VIEW (priv->new_content_view)) {
+                        g_signal_connect (priv->new_content_view,
+                                          "selection-changed",
+                                          G_CALLBACK (view_selection_changed_cb),
+                                          self);
+                }
         }
 }
 
@@ -2267,6 +2516,9 @@ nautilus_window_slot_disconnect_content_view (NautilusWindowSlot *self)
                 g_signal_handlers_disconnect_by_func (priv->content_view,
                                                       G_CALLBACK (view_is_loading_changed_cb),
                                                       self);
+                g_signal_handlers_disconnect_by_func (priv->content_view,
+                                                      G_CALLBACK (view_selection_changed_cb),
+                                                      self);
 	}
 }
 
@@ -2353,6 +2605,11 @@ nautilus_window_slot_dispose (GObject *object)
 
 	nautilus_window_slot_remove_extra_location_widgets (self);
 
+        /* Before the view lets go of the directory, reopening a closed
+         * tab should be quick as well */
+        keep_location_warm (self);
+        cancel_prefetches (self, NULL);
+
 	if (priv->content_view) {
 		widget = GTK_WIDGET (priv->content_view);
 		gtk_widget_destroy (widget);
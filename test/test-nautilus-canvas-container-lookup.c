@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <gtk/gtk.h>
+#include <src/nautilus-canvas-container.h>
+#include <src/nautilus-canvas-private.h>
+#include <src/nautilus-global-preferences.h>
+#include <src/nautilus-icon-info.h>
+
+/* Looks up icons of a large canvas container by data and by URI, and
+ * checks the URI index follows renames and removals. */
+
+#define DEFAULT_ICON_COUNT 100000
+#define LOOKUP_COUNT 10000
+
+/* The container needs these to update an icon */
+typedef NautilusCanvasContainer TestCanvasContainer;
+typedef NautilusCanvasContainerClass TestCanvasContainerClass;
+
+G_DEFINE_TYPE (TestCanvasContainer, test_canvas_container, NAUTILUS_TYPE_CANVAS_CONTAINER)
+
+static NautilusIconInfo *
+test_get_icon_images (NautilusCanvasContainer *container,
+		      NautilusCanvasIconData *data,
+		      int canvas_size,
+		      gboolean for_drag_accept)
+{
+	return nautilus_icon_info_new_for_pixbuf (NULL, 1);
+}
+
+static void
+test_get_icon_text (NautilusCanvasContainer *container,
+		    NautilusCanvasIconData *data,
+		    char **editable_text,
+		    char **additional_text,
+		    gboolean include_invisible)
+{
+	*editable_text = g_strdup_printf ("IMG_%06d.jpg", GPOINTER_TO_INT (data));
+	*additional_text = NULL;
+}
+
+static void
+test_canvas_container_class_init (TestCanvasContainerClass *klass)
+{
+	klass->get_icon_images = test_get_icon_images;
+	klass->get_icon_text = test_get_icon_text;
+}
+
+static void
+test_canvas_container_init (TestCanvasContainer *container)
+{
+}
+
+/* The icon with this data goes by another name once renamed */
+static int renamed_data = 0;
+
+static char *
+icon_uri (int data)
+{
+	if (data == renamed_data) {
+		return g_strdup_printf ("file:///tmp/lookup/renamed_%06d.jpg", data);
+	}
+
+	return g_strdup_printf ("file:///tmp/lookup/IMG_%06d.jpg", data);
+}
+
+static char *
+get_icon_uri (NautilusCanvasContainer *container,
+	      NautilusCanvasIconData *data,
+	      gpointer user_data)
+{
+	return icon_uri (GPOINTER_TO_INT (data));
+}
+
+int
+main (int argc, char **argv)
+{
+	NautilusCanvasContainer *container;
+	GTimer *timer;
+	NautilusCanvasIcon *icon;
+	char *uri, *old_uri;
+	int icon_count;
+	int found;
+	int data;
+	int i;
+
+	gtk_init (&argc, &argv);
+	nautilus_global_preferences_init ();
+
+	icon_count = argc > 1 ? atoi (argv[1]) : DEFAULT_ICON_COUNT;
+	g_assert_cmpint (icon_count, >, 1);
+
+	container = NAUTILUS_CANVAS_CONTAINER (gtk_widget_new (test_canvas_container_get_type (), NULL));
+	g_object_ref_sink (container);
+	g_signal_connect (container, "get-icon-uri", G_CALLBACK (get_icon_uri), NULL);
+
+	timer = g_timer_new ();
+	for (i = 1; i <= icon_count; i++) {
+		nautilus_canvas_container_add (container, GINT_TO_POINTER (i));
+	}
+	g_print ("added %d icons: %.3f s\n", icon_count, g_timer_elapsed (timer, NULL));
+
+	g_timer_start (timer);
+	found = 0;
+	for (i = 0; i < LOOKUP_COUNT; i++) {
+		uri = icon_uri (g_random_int_range (1, icon_count + 1));
+		if (nautilus_canvas_container_get_icon_by_uri (container, uri) != NULL) {
+			found++;
+		}
+		g_free (uri);
+	}
+	g_print ("%d lookups by URI, %d found: %.3f s\n", LOOKUP_COUNT, found, g_timer_elapsed (timer, NULL));
+	g_assert_cmpint (found, ==, LOOKUP_COUNT);
+
+	g_timer_start (timer);
+	found = 0;
+	for (i = 0; i < LOOKUP_COUNT; i++) {
+		if (g_hash_table_lookup (container->details->icon_set,
+					 GINT_TO_POINTER (g_random_int_range (1, icon_count + 1))) != NULL) {
+			found++;
+		}
+	}
+	g_print ("%d lookups by data, %d found: %.3f s\n", LOOKUP_COUNT, found, g_timer_elapsed (timer, NULL));
+	g_assert_cmpint (found, ==, LOOKUP_COUNT);
+
+	/* Rename an icon: the old URI must not find it anymore */
+	data = icon_count / 2;
+	old_uri = icon_uri (data);
+	renamed_data = data;
+	uri = icon_uri (data);
+	nautilus_canvas_container_request_update (container, GINT_TO_POINTER (data));
+	g_assert (nautilus_canvas_container_get_icon_by_uri (container, old_uri) == NULL);
+	icon = nautilus_canvas_container_get_icon_by_uri (container, uri);
+	g_assert (icon != NULL);
+	g_assert_cmpint (GPOINTER_TO_INT (icon->data), ==, data);
+	g_free (old_uri);
+
+	/* Remove it: the new URI goes away with it */
+	nautilus_canvas_container_remove (container, GINT_TO_POINTER (data));
+	g_assert (nautilus_canvas_container_get_icon_by_uri (container, uri) == NULL);
+	g_free (uri);
+	g_print ("rename and removal followed by the URI index\n");
+
+	g_timer_start (timer);
+	nautilus_canvas_container_clear (container);
+	g_print ("cleared: %.3f s\n", g_timer_elapsed (timer, NULL));
+
+	g_timer_destroy (timer);
+	g_object_unref (container);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include <gio/gio.h>
+#include <src/nautilus-directory-snapshot.h>
+
+/* Saves a listing the way folder snapshots are written to disk, reads it
+ * back and checks that the entries survive.
+ */
+
+static GFileInfo *
+file_info_new (const char *name,
+	       GFileType type,
+	       goffset size,
+	       guint64 mtime,
+	       const char *content_type,
+	       const char *icon_name)
+{
+	GFileInfo *info;
+	GIcon *icon;
+
+	info = g_file_info_new ();
+	g_file_info_set_name (info, name);
+	g_file_info_set_display_name (info, name);
+	g_file_info_set_file_type (info, type);
+	g_file_info_set_size (info, size);
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+	if (content_type != NULL) {
+		g_file_info_set_content_type (info, content_type);
+	}
+	if (icon_name != NULL) {
+		icon = g_themed_icon_new (icon_name);
+		g_file_info_set_icon (info, icon);
+		g_object_unref (icon);
+	}
+
+	return info;
+}
+
+static void
+assert_same_info (GFileInfo *a,
+		  GFileInfo *b)
+{
+	g_assert_cmpstr (g_file_info_get_name (a), ==, g_file_info_get_name (b));
+	g_assert_cmpstr (g_file_info_get_display_name (a), ==, g_file_info_get_display_name (b));
+	g_assert_cmpint (g_file_info_get_file_type (a), ==, g_file_info_get_file_type (b));
+	g_assert_cmpint (g_file_info_get_size (a), ==, g_file_info_get_size (b));
+	g_assert_cmpuint (g_file_info_get_attribute_uint64 (a, G_FILE_ATTRIBUTE_TIME_MODIFIED), ==,
+			  g_file_info_get_attribute_uint64 (b, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+	g_assert_cmpstr (g_file_info_get_content_type (a), ==, g_file_info_get_content_type (b));
+
+	if (g_file_info_get_icon (a) == NULL) {
+		g_assert (g_file_info_get_icon (b) == NULL);
+	} else {
+		g_assert (g_icon_equal (g_file_info_get_icon (a), g_file_info_get_icon (b)));
+	}
+}
+
+int
+main (int argc, char **argv)
+{
+	GList *infos, *loaded, *a, *b;
+	GVariant *snapshot, *reloaded;
+	GBytes *bytes;
+
+	infos = NULL;
+	infos = g_list_append (infos, file_info_new ("Documents", G_FILE_TYPE_DIRECTORY, 0, 1400000000,
+						     "inode/directory", "folder"));
+	infos = g_list_append (infos, file_info_new ("IMG_0001.jpg", G_FILE_TYPE_REGULAR, 2345678, 1400000001,
+						     "image/jpeg", "image-jpeg"));
+	infos = g_list_append (infos, file_info_new ("notes", G_FILE_TYPE_REGULAR, 12, 1400000002,
+						     NULL, NULL));
+
+	snapshot = g_variant_ref_sink (nautilus_directory_snapshot_from_infos (infos));
+
+	/* Go through the serialized form, like a snapshot read from disk */
+	bytes = g_variant_get_data_as_bytes (snapshot);
+	reloaded = g_variant_ref_sink (g_variant_new_from_bytes (g_variant_get_type (snapshot), bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	loaded = nautilus_directory_snapshot_to_infos (reloaded);
+	g_assert_cmpuint (g_list_length (loaded), ==, g_list_length (infos));
+
+	for (a = infos, b = loaded; a != NULL; a = a->next, b = b->next) {
+		assert_same_info (a->data, b->data);
+	}
+
+	g_print ("%u entries saved and loaded back\n", g_list_length (loaded));
+
+	g_list_free_full (loaded, g_object_unref);
+	g_list_free_full (infos, g_object_unref);
+	g_variant_unref (reloaded);
+	g_variant_unref (snapshot);
+
+	return 0;
+}